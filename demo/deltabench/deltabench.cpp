@@ -0,0 +1,178 @@
+/*  Berkelium sample application
+ *  deltabench.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Loopback benchmark for DeltaEncoder/DeltaDecoder. Scrolls a synthetic
+// text page the way the renderer paints it (a scroll op plus the exposed
+// strip), with a blinking caret and the occasional full repaint, then
+// checks that the decoder rebuilds every frame exactly. Needs no Chromium.
+
+#include "berkelium/DeltaStream.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+using namespace Berkelium;
+
+namespace {
+
+const int kWidth = 1024;
+const int kHeight = 768;
+const int kLineHeight = 24;
+
+// Pixel of a never-ending page of text: white background, dark glyph-ish
+// blocks on every line, and a coloured band every few screens.
+unsigned int pagePixel(int x, int y) {
+    const int line = y / kLineHeight;
+    if ((line / 64) % 2 && x < 48) {
+        return 0xff3366cc;
+    }
+    const int inLine = y % kLineHeight;
+    const int lineLength = 200 + (line * 7919) % 700;
+    if (inLine < 5 || inLine >= 19 || x < 40 || x >= 40 + lineLength) {
+        return 0xffffffff;
+    }
+    const int glyph = (x - 40) / 9;
+    unsigned int h = (unsigned int)(glyph * 2654435761u) ^
+        (unsigned int)(line * 40503u);
+    if ((h >> 7) % 6 == 0) {
+        // Space between words.
+        return 0xffffffff;
+    }
+    h ^= (unsigned int)((x - 40) % 9) * 97u + (unsigned int)inLine * 31u;
+    h *= 2246822519u;
+    return (h >> 29) < 3 ? 0xff202020 : 0xffffffff;
+}
+
+void renderPage(int scrollY, const Rect &rect, std::vector<unsigned char> &out) {
+    out.resize((size_t)rect.width() * rect.height() * 4);
+    unsigned int *pixels = (unsigned int*)&out[0];
+    for (int y = 0; y < rect.height(); ++y) {
+        for (int x = 0; x < rect.width(); ++x) {
+            *pixels++ = pagePixel(rect.left() + x, scrollY + rect.top() + y);
+        }
+    }
+}
+
+Rect makeRect(int left, int top, int width, int height) {
+    Rect rect;
+    rect.mLeft = left;
+    rect.mTop = top;
+    rect.mWidth = width;
+    rect.mHeight = height;
+    return rect;
+}
+
+double seconds(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+}
+
+int main(int argc, char **argv) {
+    const int frames = argc > 1 ? atoi(argv[1]) : 600;
+    const int scrollStep = 40;
+    const Rect view = makeRect(0, 0, kWidth, kHeight);
+
+    DeltaEncoder encoder;
+    DeltaDecoder decoder;
+    std::vector<unsigned char> source;
+    std::vector<unsigned char> stream;
+    std::vector<unsigned char> expected;
+    double encodeTime = 0, decodeTime = 0;
+    unsigned long long fullFrameBytes = 0;
+    int scrollY = 0;
+
+    for (int frame = 0; frame < frames; ++frame) {
+        // Caret blinks on at frame 5 of every 10 and off again at frame 6;
+        // every other frame scrolls, with a full repaint now and then.
+        const bool caretOn = frame % 10 == 5;
+        const bool caretOff = frame % 10 == 6;
+        clock_t start;
+        if (frame % 100 == 0) {
+            renderPage(scrollY, view, source);
+            start = clock();
+            encoder.encodePaint(kWidth, kHeight, &source[0], view,
+                                1, &view, 0, 0, Rect());
+        } else if (caretOn || caretOff) {
+            Rect caret = makeRect(300, 100, 2, 18);
+            renderPage(scrollY, caret, source);
+            if (caretOn) {
+                memset(&source[0], 0, source.size());
+            }
+            start = clock();
+            encoder.encodePaint(kWidth, kHeight, &source[0], caret,
+                                1, &caret, 0, 0, Rect());
+        } else {
+            scrollY += scrollStep;
+            // The renderer scrolls the view and paints the exposed strip.
+            Rect strip = makeRect(0, kHeight - scrollStep, kWidth, scrollStep);
+            renderPage(scrollY, strip, source);
+            start = clock();
+            encoder.encodePaint(kWidth, kHeight, &source[0], strip,
+                                1, &strip, 0, -scrollStep, view);
+        }
+        encodeTime += seconds(start);
+        fullFrameBytes += (unsigned long long)kWidth * kHeight * 4;
+
+        encoder.takeOutput(stream);
+        start = clock();
+        if (!decoder.decode(&stream[0], stream.size())) {
+            fprintf(stderr, "frame %d: decoder rejected the stream\n", frame);
+            return 1;
+        }
+        decodeTime += seconds(start);
+
+        if (!caretOn) {
+            renderPage(scrollY, view, expected);
+            if (decoder.width() != kWidth || decoder.height() != kHeight ||
+                memcmp(decoder.data(), &expected[0], expected.size())) {
+                fprintf(stderr, "frame %d: decoded frame differs\n", frame);
+                return 1;
+            }
+        }
+    }
+
+    const double mb = 1024.0 * 1024.0;
+    printf("%d frames of %dx%d, all decoded exactly\n",
+           frames, kWidth, kHeight);
+    printf("full frames:   %10.1f MB\n", fullFrameBytes / mb);
+    printf("copy rects:    %10.1f MB\n", encoder.inputBytes() / mb);
+    printf("delta stream:  %10.1f MB (%.1fx smaller than full frames)\n",
+           encoder.outputBytes() / mb,
+           (double)fullFrameBytes / (double)encoder.outputBytes());
+    printf("encode: %.3f s, decode: %.3f s (%.1f frames/s round trip)\n",
+           encodeTime, decodeTime, frames / (encodeTime + decodeTime));
+    return 0;
+}
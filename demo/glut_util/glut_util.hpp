@@ -71,7 +71,9 @@ using namespace Berkelium;
  *         if you have loaded a new page, but updates for the old page have not
  *         completed yet.
  *  \param scroll_buffer - a temporary workspace used for scroll data.  Must be
- *         at least dest_texture_width * dest_texture_height * 4 bytes large.
+ *         at least dest_texture_width * (dest_texture_height+1) * 4 bytes
+ *         large.  May be NULL if the window has its canvas enabled, since
+ *         scrolls are then applied inside Berkelium and never reach here.
  *  \returns true if the texture was updated, false otherwiase
  */
 bool mapOnPaintToTexture(
@@ -186,6 +188,9 @@ bool mapOnPaintToTexture(
                 <<") tex size "<<dest_texture_width<<"x"<<dest_texture_height
                 <<std::endl;
     }
+    // Upload each copy rect straight out of the source buffer by describing
+    // its layout to GL, rather than packing it into scroll_buffer first.
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap_rect.width());
     for (size_t i = 0; i < num_copy_rects; i++) {
         int wid = copy_rects[i].width();
         int hig = copy_rects[i].height();
@@ -195,22 +200,20 @@ bool mapOnPaintToTexture(
             std::cout << "Copy rect: w=" << wid << ", h=" << hig << ", ("
                       << top << "," << left << ")" << std::endl;
         }
-        for(int jj = 0; jj < hig; jj++) {
-            memcpy(
-                scroll_buffer + jj*wid*kBytesPerPixel,
-                bitmap_in + (left + (jj+top)*bitmap_rect.width())*kBytesPerPixel,
-                wid*kBytesPerPixel
-                );
-        }
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, left);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, top);
 
         // Finally, we perform the main update, just copying the rect that is
         // marked as dirty but not from scrolled data.
         glTexSubImage2D(GL_TEXTURE_2D, 0,
                         copy_rects[i].left(), copy_rects[i].top(),
                         wid, hig,
-                        GL_BGRA, GL_UNSIGNED_BYTE, scroll_buffer
+                        GL_BGRA, GL_UNSIGNED_BYTE, bitmap_in
             );
     }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -318,18 +321,18 @@ public:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-        scroll_buffer = new char[width*(height+1)*4];
-
         Berkelium::Context *context = Berkelium::Context::create();
         bk_window = Berkelium::Window::create(context);
         delete context;
         bk_window->setDelegate(this);
         bk_window->resize(width, height);
         bk_window->setTransparent(_usetrans);
+        // Let Berkelium apply scrolls to its own copy of the page, so we only
+        // ever upload damaged rects and never read the texture back.
+        bk_window->setCanvasEnabled(true);
     }
 
     ~GLTextureWindow() {
-        delete scroll_buffer;
         delete bk_window;
     }
 
@@ -365,7 +368,7 @@ public:
         bool updated = mapOnPaintToTexture(
             wini, bitmap_in, bitmap_rect, num_copy_rects, copy_rects,
             dx, dy, scroll_rect,
-            web_texture, width, height, needs_full_refresh, scroll_buffer
+            web_texture, width, height, needs_full_refresh, NULL
         );
         if (updated) {
             needs_full_refresh = false;
@@ -520,8 +523,6 @@ private:
     unsigned int web_texture;
     // Bool indicating when we need to refresh the entire image
     bool needs_full_refresh;
-    // Buffer used to store data for scrolling
-    char* scroll_buffer;
 };
 
 #endif //_BERKELIUM_GLUT_UTIL_HPP_
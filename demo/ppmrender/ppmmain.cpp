@@ -34,6 +34,7 @@
 #include "berkelium/Window.hpp"
 #include "berkelium/WindowDelegate.hpp"
 #include "berkelium/Context.hpp"
+#include "berkelium/FrameCapture.hpp"
 
 #include <stdio.h>
 #include <sys/types.h>
@@ -52,7 +53,9 @@ using namespace Berkelium;
 
 class TestDelegate : public WindowDelegate {
     std::string mURL;
+    FrameCapture *mCapture;
 public:
+    TestDelegate(FrameCapture *capture) : mCapture(capture) {}
 
     virtual void onAddressBarChanged(Window *win, URLString newURL) {
         std::string x = "hi";
@@ -106,32 +109,13 @@ public:
                          int dx, int dy, const Rect &scroll_rect) {
         std::cout << "*** onPaint "<<mURL<<std::endl;
         static int call_count = 0;
-        FILE *outfile;
-        {
-            std::ostringstream os;
-            os << "/tmp/chromium_render_" << time(NULL) << "_" << (call_count++) << ".ppm";
-            std::string str (os.str());
-            outfile = fopen(str.c_str(), "wb");
-        }
-        const int width = bitmap_rect.width();
-        const int height = bitmap_rect.height();
-
-        fprintf(outfile, "P6 %d %d 255\n", width, height);
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                unsigned char r,g,b,a;
-		b = *(bitmap_in++);
-		g = *(bitmap_in++);
-		r = *(bitmap_in++);
-		a = *(bitmap_in++);
-                fputc(r, outfile);  // Red
-                //fputc(255-a, outfile);  // Alpha
-                fputc(g, outfile);  // Green
-                fputc(b, outfile);  // Blue
-                //(pixel >> 24) & 0xff;  // Alpha
-            }
+        std::ostringstream os;
+        os << "/tmp/chromium_render_" << time(NULL) << "_" << (call_count++) << ".ppm";
+        std::string str (os.str());
+        // Only copies the canvas; the file is written on the capture thread.
+        if (!mCapture->capture(wini, FileString::point_to(str))) {
+            std::cout << "*** dropped frame "<<str<<std::endl;
         }
-        fclose(outfile);
     }
 
     virtual void onCrashed(Window *win) {
@@ -140,7 +124,8 @@ public:
 
     virtual void onCreatedWindow(Window *win, Window *newWindow, const Rect &initialRect) {
         std::cout << "*** onCreatedWindow from source "<<mURL<<std::endl;
-        newWindow->setDelegate(new TestDelegate);
+        newWindow->setDelegate(new TestDelegate(mCapture));
+        newWindow->setCanvasEnabled(true);
     }
 
     virtual void onExternalHost(
@@ -211,11 +196,19 @@ int main (int argc, char **argv) {
     win3->navigateTo(url.data(),url.length());
 */
 
+    std::auto_ptr<FrameCapture> capture(
+        FrameCapture::create(CAPTURE_FORMAT_PPM, 4, CAPTURE_DROP_OLDEST));
     Context *context = Context::create();
     std::auto_ptr<Window> win4(Window::create(context));
     delete context;
     win4->resize(800,600);
-    win4->setDelegate(new TestDelegate);
+    // onLoad resizes four times in a row; only the last size is rendered.
+    ResizePolicy resizePolicy;
+    resizePolicy.mDebounceMilliseconds = 100;
+    resizePolicy.mSurfaceQuantum = 64;
+    win4->setResizePolicy(resizePolicy);
+    win4->setDelegate(new TestDelegate(capture.get()));
+    win4->setCanvasEnabled(true);
     if (argc < 2) {
         url="http://xkcd.com";
     } else {
@@ -0,0 +1,155 @@
+/*  Berkelium sample application
+ *  textbench.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Times typing a long string into a textarea one key event per character
+// against committing it in bulk (see Window::setBulkTextThreshold). The
+// page reports the textarea length through its title, and a run ends once
+// all of the text has arrived.
+
+#include "berkelium/Berkelium.hpp"
+#include "berkelium/Window.hpp"
+#include "berkelium/WindowDelegate.hpp"
+#include "berkelium/Context.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/select.h>
+#include <sys/time.h>
+#endif
+#include <memory>
+
+using namespace Berkelium;
+
+namespace {
+
+const char kPage[] =
+    "data:text/html,<textarea id=t autofocus></textarea><script>"
+    "setInterval(function(){"
+    "document.title=document.getElementById('t').value.length;},5);"
+    "</script>";
+
+double now() {
+#ifdef _WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+void pump() {
+    Berkelium::update();
+#ifdef _WIN32
+    Sleep(1);
+#else
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 1000;
+    select(0, NULL, NULL, NULL, &tv);
+#endif
+}
+
+class LengthDelegate : public WindowDelegate {
+public:
+    bool mLoaded;
+    long mLength;
+
+    LengthDelegate() : mLoaded(false), mLength(-1) {}
+
+    virtual void onLoad(Window *win) {
+        mLoaded = true;
+    }
+    virtual void onTitleChanged(Window *win, WideString title) {
+        mLength = wcstol(std::wstring(title.data(), title.length()).c_str(),
+                         NULL, 10);
+    }
+};
+
+// Types text into the cleared textarea and returns the seconds until the
+// page has all of it, or a negative value on timeout.
+double timeTyping(Window *win, LengthDelegate *delegate,
+                  const std::wstring &text) {
+    std::wstring clear = L"document.getElementById('t').value='';";
+    win->executeJavascript(WideString::point_to(clear));
+    while (delegate->mLength != 0) {
+        pump();
+    }
+    double start = now();
+    win->textEvent(text.data(), text.length());
+    while (delegate->mLength != (long)text.length()) {
+        if (now() - start > 120) {
+            return -1;
+        }
+        pump();
+    }
+    return now() - start;
+}
+
+}
+
+int main(int argc, char **argv) {
+    size_t length = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+    std::wstring text;
+    for (size_t i = 0; i < length; ++i) {
+        text += (wchar_t)(i % 64 == 63 ? L'\n' : L'a' + i % 26);
+    }
+
+    Berkelium::init(FileString::empty());
+    Context *context = Context::create();
+    std::auto_ptr<Window> win(Window::create(context));
+    delete context;
+    LengthDelegate delegate;
+    win->setDelegate(&delegate);
+    win->resize(640, 480);
+    win->navigateTo(URLString::point_to(kPage, sizeof(kPage) - 1));
+    while (!delegate.mLoaded || delegate.mLength < 0) {
+        pump();
+    }
+    win->focus();
+
+    win->setBulkTextThreshold(0);
+    double typed = timeTyping(win.get(), &delegate, text);
+    win->setBulkTextThreshold(1);
+    double bulk = timeTyping(win.get(), &delegate, text);
+
+    printf("%lu characters\n", (unsigned long)length);
+    printf("  key events:  %8.3f s\n", typed);
+    printf("  bulk commit: %8.3f s\n", bulk);
+    win.reset();
+    Berkelium::destroy();
+    return typed < 0 || bulk < 0;
+}
@@ -45,6 +45,8 @@ namespace Berkelium {
 
 /** May be implemented to handle global errors gracefully.
  */
+class FrameBatchDelegate;
+
 class BERKELIUM_EXPORT ErrorDelegate {
 public:
     virtual ~ErrorDelegate() {}
@@ -92,6 +94,34 @@ void BERKELIUM_EXPORT setErrorHandler(ErrorDelegate * errorHandler);
  */
 void BERKELIUM_EXPORT update();
 
+/** Applies canvas paints on a pool of background threads, so several
+ *  Windows can update their canvases in parallel and the UI thread only
+ *  does the hand-off. Only affects Windows with the canvas enabled and
+ *  leased frames disabled.
+ *
+ *  Paints still reach your WindowDelegate from within update(), which waits
+ *  for the workers before returning, so a canvas never changes between two
+ *  calls to update().
+ *  \param numThreads  Number of paint threads, or 0 (the default) to paint
+ *    on the calling thread.
+ */
+void BERKELIUM_EXPORT setPaintThreads(unsigned int numThreads);
+
+/** Collects the paints of all canvas-enabled Windows into one
+ *  FrameBatchDelegate::onFrameBatch call at the end of each update(),
+ *  instead of an onPaint or onWidgetPaint call per paint. Windows without
+ *  the canvas, or using leased frames, keep painting as before.
+ *  \param delegate  Receives the batches, or NULL to go back to onPaint.
+ */
+void BERKELIUM_EXPORT setFrameBatchDelegate(FrameBatchDelegate *delegate);
+
+/** Returns the current time on the monotonic, high resolution clock that
+ *  input events are stamped with, in seconds since an unspecified point.
+ *  Use it to translate the times of your own events into
+ *  InputEvent::mTimestamp.
+ */
+double BERKELIUM_EXPORT monotonicTime();
+
 }
 
 #endif
@@ -0,0 +1,83 @@
+/*  Berkelium - Embedded Chromium
+ *  CoalescePolicy.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_COALESCE_POLICY_HPP_
+#define _BERKELIUM_COALESCE_POLICY_HPP_
+
+#include "berkelium/Platform.hpp"
+
+namespace Berkelium {
+
+/** Controls how the copy rects of a paint are rearranged before they reach
+ *  WindowDelegate::onPaint, see Window::setCoalescePolicy.
+ *
+ *  Rects can only be merged when the Window has its canvas enabled, since
+ *  the renderer's buffer holds no valid pixels between its copy rects.
+ *  Without a canvas every strategy other than COALESCE_NONE behaves like
+ *  COALESCE_MIN_BYTES and mMaxRects is ignored.
+ */
+struct CoalescePolicy {
+    enum Strategy {
+        /** Deliver rects as the renderer sent them. */
+        COALESCE_NONE,
+        /** Split overlapping rects so that no pixel is delivered twice, but
+         *  never merge rects.
+         */
+        COALESCE_MIN_BYTES,
+        /** Deliver a single rect covering all of the damage. */
+        COALESCE_MIN_CALLS,
+        /** Merge two rects whenever copying the extra pixels in their
+         *  bounding box costs less than mCallOverheadBytes.
+         */
+        COALESCE_COST_MODEL
+    };
+
+    Strategy mStrategy;
+    /** Estimated fixed cost of one copy or upload call, expressed as the
+     *  number of bytes that could have been copied instead. Pixels are
+     *  costed in the Window's output format, plus its YUV copy if one is
+     *  kept. Only used by COALESCE_COST_MODEL.
+     */
+    unsigned int mCallOverheadBytes;
+    /** Upper bound on the number of rects per paint, or 0 for no limit.
+     *  Once over the limit, the cheapest rects to combine are merged.
+     */
+    unsigned int mMaxRects;
+
+    CoalescePolicy()
+        : mStrategy(COALESCE_NONE), mCallOverheadBytes(4096), mMaxRects(0) {
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+/*  Berkelium - Embedded Chromium
+ *  DeltaStream.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_DELTA_STREAM_HPP_
+#define _BERKELIUM_DELTA_STREAM_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+#include <vector>
+
+namespace Berkelium {
+
+class Canvas;
+
+/** Turns paints into a compact byte stream for mirroring a Window on a
+ *  remote display. Scrolls are sent as copy operations that the receiver
+ *  applies to its own frame, so scrolled pixels are never sent again, and
+ *  each changed rect is run-length compressed when that makes it smaller.
+ *
+ *  The stream is a sequence of frames, one per paint, made of these ops
+ *  (integers are little-endian, rects are int32 left, top, width, height):
+ *  - 'F' int32 width, int32 height: starts a frame of the given page size.
+ *  - 'S' rect, int32 dx, int32 dy: scrolls the rect within the frame.
+ *  - 'R' rect, uint8 codec, uint32 length, payload: replaces the rect with
+ *    BGRA pixels, raw (codec 0) or run-length coded (codec 1).
+ *  - 'E': ends the frame.
+ *  Run-length payloads are packets of one byte n followed by n+1 literal
+ *  pixels, or, if n has the high bit set, one pixel repeated (n&0x7f)+2
+ *  times.
+ *
+ *  See Window::setDeltaEncoder to feed a Window's paints in directly.
+ */
+class BERKELIUM_EXPORT DeltaEncoder {
+public:
+    DeltaEncoder();
+
+    /** Appends one paint to the stream. The parameters are those of
+     *  WindowDelegate::onPaint with the canvas disabled.
+     * \param viewWidth  Width of the page.
+     * \param viewHeight  Height of the page.
+     */
+    void encodePaint(int viewWidth, int viewHeight,
+                     const unsigned char *sourceBuffer,
+                     const Rect &sourceBufferRect,
+                     size_t numCopyRects, const Rect *copyRects,
+                     int dx, int dy, const Rect &scrollRect);
+
+    /** Replaces out with everything encoded since the last call. Swaps
+     *  storage, so passing the same vector every time does not allocate.
+     */
+    void takeOutput(std::vector<unsigned char> &out);
+
+    /** Bytes encoded but not yet taken. */
+    size_t pendingBytes() const {
+        return mOutput.size();
+    }
+
+    /** Pixel bytes passed in, for working out the compression ratio. */
+    unsigned long long inputBytes() const {
+        return mInputBytes;
+    }
+    /** Bytes of stream produced. */
+    unsigned long long outputBytes() const {
+        return mOutputBytes;
+    }
+
+private:
+    void encodeRect(const unsigned char *sourceBuffer,
+                    const Rect &sourceBufferRect, const Rect &rect);
+
+    std::vector<unsigned char> mOutput;
+    // Run-length payload of the rect being encoded, and its pixels gathered
+    // into one block when they are not contiguous in the source.
+    std::vector<unsigned char> mPayload;
+    std::vector<unsigned char> mBlock;
+    unsigned long long mInputBytes;
+    unsigned long long mOutputBytes;
+};
+
+/** Rebuilds the frame sent by a DeltaEncoder. Does not depend on Chromium,
+ *  so viewers can link against the berkelium_delta library alone.
+ */
+class BERKELIUM_EXPORT DeltaDecoder {
+public:
+    DeltaDecoder();
+    ~DeltaDecoder();
+
+    /** Applies every frame in data, which must hold whole frames.
+     * \returns false if the stream is malformed, in which case the frame
+     *     holds whatever was applied before the error.
+     */
+    bool decode(const unsigned char *data, size_t size);
+
+    int width() const;
+    int height() const;
+    /** Current frame in BGRA, with a stride of width()*4. */
+    const unsigned char *data() const;
+
+private:
+    DeltaDecoder(const DeltaDecoder&);
+    DeltaDecoder &operator=(const DeltaDecoder&);
+
+    Canvas *mCanvas;
+    // Decoded pixels of the rect being applied.
+    std::vector<unsigned char> mPixels;
+};
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*  Berkelium - Embedded Chromium
+ *  DirtyTile.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_DIRTY_TILE_HPP_
+#define _BERKELIUM_DIRTY_TILE_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+
+namespace Berkelium {
+
+/** One changed tile of a Window's canvas, see Window::setTileSize and
+ *  Window::drainDirtyTiles.
+ */
+struct DirtyTile {
+    /** Position of the tile in the grid, counted in tiles from the top left. */
+    int mColumn;
+    int mRow;
+    /** Area of the Window covered by the tile. Tiles along the right and
+     *  bottom edges are clipped to the Window and may be smaller than the
+     *  tile size.
+     */
+    Rect mRect;
+    /** Top left pixel of the tile inside the frame, in the Window's output
+     *  format (see Window::setOutputFormat). Valid until the next call to
+     *  Berkelium::update().
+     */
+    const unsigned char *mData;
+    /** Bytes between the start of consecutive rows of mData. */
+    size_t mStride;
+};
+
+}
+
+#endif
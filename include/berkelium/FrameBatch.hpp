@@ -0,0 +1,89 @@
+/*  Berkelium - Embedded Chromium
+ *  FrameBatch.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAME_BATCH_HPP_
+#define _BERKELIUM_FRAME_BATCH_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+#include "berkelium/PixelFormat.hpp"
+
+namespace Berkelium {
+
+class Window;
+class Widget;
+
+/** One Window or Widget canvas that changed during a call to
+ *  Berkelium::update(), see FrameBatchDelegate.
+ */
+struct FrameUpdate {
+    Window *mWindow;
+    /** The widget that was painted, or NULL for the Window's page. */
+    Widget *mWidget;
+    /** Top left pixel of the whole canvas. Valid until the next call to
+     *  Berkelium::update() or until the Window is destroyed.
+     */
+    const unsigned char *mData;
+    /** Bytes between the start of consecutive rows of mData. */
+    size_t mStride;
+    /** The Window's output format for page canvases (see
+     *  Window::setOutputFormat). Widget canvases are always BGRA.
+     */
+    PixelFormat mFormat;
+    /** Area covered by mData, relative to the Window. */
+    Rect mRect;
+    /** Rects of mData changed since the last batch, relative to mData. */
+    size_t mNumDirtyRects;
+    const Rect *mDirtyRects;
+};
+
+/** Receives every canvas change of one Berkelium::update() in a single call,
+ *  so that an application can upload them in one pass. See
+ *  Berkelium::setFrameBatchDelegate.
+ */
+class BERKELIUM_EXPORT FrameBatchDelegate {
+public:
+    virtual ~FrameBatchDelegate() {}
+
+    /** Called at the end of Berkelium::update() if anything changed.
+     *
+     * \param numUpdates  Length of updates.
+     * \param updates  Changed canvases, each Window's page before its
+     *     widgets. Only valid during this call.
+     */
+    virtual void onFrameBatch(size_t numUpdates,
+                              const FrameUpdate *updates) = 0;
+};
+
+}
+
+#endif
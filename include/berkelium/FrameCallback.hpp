@@ -0,0 +1,60 @@
+/*  Berkelium - Embedded Chromium
+ *  FrameCallback.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAME_CALLBACK_HPP_
+#define _BERKELIUM_FRAME_CALLBACK_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/FrameBatch.hpp"
+
+namespace Berkelium {
+
+class Window;
+
+/** Receives the frame asked for with Window::requestFrame. */
+class BERKELIUM_EXPORT FrameCallback {
+public:
+    virtual ~FrameCallback() {}
+
+    /** Called once per request, from within Berkelium::update().
+     *
+     * \param win  Window the frame was requested from.
+     * \param frame  The whole canvas, with mDirtyRects listing everything
+     *     that changed since the previous requested frame. Only valid
+     *     during this call.
+     */
+    virtual void onFrame(Window *win, const FrameUpdate &frame) = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*  Berkelium - Embedded Chromium
+ *  FrameCapture.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAME_CAPTURE_HPP_
+#define _BERKELIUM_FRAME_CAPTURE_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/WeakString.hpp"
+
+namespace Berkelium {
+
+class Window;
+
+/** File formats a FrameCapture can write. */
+enum CaptureFormat {
+    /** Binary PPM (P6), without alpha. */
+    CAPTURE_FORMAT_PPM,
+    /** PNG with straight alpha. */
+    CAPTURE_FORMAT_PNG,
+    /** The canvas pixels as they are: premultiplied BGRA, rows of
+     *  width*4 bytes, no header.
+     */
+    CAPTURE_FORMAT_RAW
+};
+
+/** What FrameCapture::capture does when every buffer is still waiting to
+ *  be written.
+ */
+enum CaptureDropPolicy {
+    /** Drops the new frame; frames already queued are kept. */
+    CAPTURE_DROP_NEWEST,
+    /** Replaces the oldest frame that is not being written yet, or drops
+     *  the new frame if every buffer is being written.
+     */
+    CAPTURE_DROP_OLDEST,
+    /** Waits for the writer to free a buffer. */
+    CAPTURE_BLOCK
+};
+
+/** Writes snapshots of Window canvases to disk on a background thread.
+ *  capture() only copies the canvas into one of a fixed ring of buffers,
+ *  so the UI thread never waits on encoding or file I/O unless the
+ *  CAPTURE_BLOCK policy asks it to. The number of buffers bounds both the
+ *  memory used and how far the writer may fall behind.
+ *
+ *  capture() and flush() must be called from the thread that calls
+ *  Berkelium::update(). Destroying the FrameCapture writes out every
+ *  queued frame first.
+ */
+class BERKELIUM_EXPORT FrameCapture {
+protected:
+    FrameCapture() {}
+
+public:
+    /** Starts a writer thread.
+     * \param format  File format of every frame written.
+     * \param numBuffers  Frames that may be queued at once, at least 1.
+     * \param policy  What to do with a frame when all buffers are in use.
+     */
+    static FrameCapture *create(CaptureFormat format, int numBuffers,
+                                CaptureDropPolicy policy);
+
+    virtual ~FrameCapture() {}
+
+    /** Queues the canvas of win to be written to path. The Window must
+     *  have setCanvasEnabled turned on.
+     * \returns false if the Window has no canvas or the frame was dropped.
+     */
+    virtual bool capture(Window *win, FileString path)=0;
+
+    /** Queues a frame held by the application, e.g. the sourceBuffer of an
+     *  onPaint with the canvas enabled and the default output format.
+     * \param bgra  Premultiplied BGRA pixels.
+     * \param stride  Bytes between rows of bgra.
+     * \returns false if the frame was dropped.
+     */
+    virtual bool captureBuffer(const unsigned char *bgra, size_t stride,
+                               int width, int height, FileString path)=0;
+
+    /** Blocks until every queued frame has been written. */
+    virtual void flush()=0;
+
+    /** Frames written to disk so far. */
+    virtual unsigned long long framesWritten() const=0;
+    /** Frames discarded by the drop policy. */
+    virtual unsigned long long framesDropped() const=0;
+    /** Frames that could not be encoded or written. */
+    virtual unsigned long long writeErrors() const=0;
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*  Berkelium - Embedded Chromium
+ *  FrameExchange.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAME_EXCHANGE_HPP_
+#define _BERKELIUM_FRAME_EXCHANGE_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/PixelFormat.hpp"
+#include "berkelium/Rect.hpp"
+
+namespace Berkelium {
+
+/** A frame taken from a FrameExchange. */
+struct ExchangedFrame {
+    /** Top left pixel, or NULL if nothing has been published yet. Valid
+     *  until the next call to FrameExchange::acquire.
+     */
+    const unsigned char *mData;
+    /** Bytes between the start of consecutive rows of mData. */
+    size_t mStride;
+    PixelFormat mFormat;
+    /** Area covered by mData, relative to the Window. */
+    Rect mRect;
+    /** Counts publish() calls, starting at 1, so a reader can tell how many
+     *  frames it skipped.
+     */
+    unsigned long long mSequence;
+};
+
+/** Hands the latest frame from the thread calling Berkelium::update() to
+ *  a reader on any other thread without locks. Three buffers rotate
+ *  between the writer, the reader and the most recently published frame,
+ *  so neither side ever waits for the other and the reader never sees a
+ *  frame that is still being written. Frames published faster than they
+ *  are read are skipped, never queued.
+ *
+ *  Publishing only copies the damaged rects into the buffer being written,
+ *  plus whatever changed since that buffer last held a frame.
+ *
+ *  publish() must be called from one thread at a time, typically by a
+ *  Window given the exchange with Window::setFrameExchange. acquire() must
+ *  likewise be called by one reader at a time.
+ */
+class BERKELIUM_EXPORT FrameExchange {
+protected:
+    FrameExchange() {}
+
+public:
+    static FrameExchange *create();
+
+    virtual ~FrameExchange() {}
+
+    /** Copies a frame into the writer's buffer and makes it the latest.
+     * \param data  Top left pixel of the whole frame.
+     * \param stride  Bytes between rows of data.
+     * \param format  Layout of data; passed on to readers.
+     * \param rect  Area covered by data, relative to the Window.
+     * \param numDirtyRects  Rects changed since the previous publish,
+     *     relative to data. Ignored when the size or format changes.
+     */
+    virtual void publish(const unsigned char *data, size_t stride,
+                         PixelFormat format, const Rect &rect,
+                         size_t numDirtyRects, const Rect *dirtyRects)=0;
+
+    /** Takes the latest published frame, releasing the one taken before.
+     * \param frame  Receives the latest frame, which is the previous one
+     *     again if nothing new was published.
+     * \returns true if frame is newer than the one previously acquired.
+     */
+    virtual bool acquire(ExchangedFrame &frame)=0;
+};
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*  Berkelium - Embedded Chromium
+ *  FrameLease.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAME_LEASE_HPP_
+#define _BERKELIUM_FRAME_LEASE_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+
+namespace Berkelium {
+
+/** A FrameLease is a reference counted handle to a paint which still lives in
+ *  the renderer's shared memory. It is only handed out when leased frames have
+ *  been enabled with Window::setLeasedFrames.
+ *
+ *  The renderer is not told that its buffer may be reused until every
+ *  reference has been released, so the pixels stay valid and unchanged for as
+ *  long as the lease is held. This makes it possible to upload directly out of
+ *  the shared memory (for instance from a worker thread) instead of copying
+ *  the buffer before onPaint returns. Note that the renderer will not send
+ *  another paint for the same Window or Widget until the lease is released,
+ *  so holding onto a lease for long periods stalls that page.
+ *
+ *  addRef() and release() may be called from any thread. If the final
+ *  release happens on another thread, the paint is acknowledged during the
+ *  next call to Berkelium::update().
+ */
+class BERKELIUM_EXPORT FrameLease {
+protected:
+    virtual ~FrameLease() {}
+
+public:
+    /** Takes an additional reference to this lease. */
+    virtual void addRef()=0;
+
+    /** Drops a reference. The lease is destroyed and the paint acknowledged
+     *  once the last reference is released; the buffer must not be accessed
+     *  after that.
+     */
+    virtual void release()=0;
+
+    /** BGRA buffer with width/height of getBufferRect(). */
+    virtual const unsigned char *getBuffer() const=0;
+
+    /** Rect covered by getBuffer(), in Window coordinates. */
+    virtual const Rect &getBufferRect() const=0;
+
+    /** Number of entries in getCopyRects(). */
+    virtual size_t getNumCopyRects() const=0;
+
+    /** Array of valid+changed rectangles of the buffer, not relative to
+     *  getBufferRect(). See WindowDelegate::onPaint.
+     */
+    virtual const Rect *getCopyRects() const=0;
+
+    /** Horizontal scroll amount applied to getScrollRect(), or 0. */
+    virtual int getScrollX() const=0;
+
+    /** Vertical scroll amount applied to getScrollRect(), or 0. */
+    virtual int getScrollY() const=0;
+
+    /** Area of the page to scroll. Only valid if getScrollX() or
+     *  getScrollY() is non-zero.
+     */
+    virtual const Rect &getScrollRect() const=0;
+};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*  Berkelium - Embedded Chromium
+ *  InputEvent.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_INPUT_EVENT_HPP_
+#define _BERKELIUM_INPUT_EVENT_HPP_
+
+#include "berkelium/Platform.hpp"
+
+namespace Berkelium {
+
+/** One entry of a batch passed to Window::injectInput. Each type mirrors
+ *  the Window method of the same name and uses only the fields listed for
+ *  it; the static functions fill in the rest.
+ */
+struct InputEvent {
+    enum Type {
+        /** Window::mouseMoved; uses mX and mY. */
+        MOUSE_MOVED,
+        /** Window::mouseButton; uses mButton and mDown. */
+        MOUSE_BUTTON,
+        /** Window::mouseWheel; uses mX and mY as the scroll amounts. */
+        MOUSE_WHEEL,
+        /** Window::keyEvent; uses mDown, mModifiers, mVirtualKey and
+         *  mScancode.
+         */
+        KEY,
+        /** Window::textEvent; uses mText and mTextLength. */
+        TEXT
+    };
+
+    Type mType;
+    int mX;
+    int mY;
+    unsigned int mButton;
+    bool mDown;
+    int mModifiers;
+    int mVirtualKey;
+    int mScancode;
+    /** Only read during injectInput; the caller keeps ownership. */
+    const wchar_t *mText;
+    size_t mTextLength;
+    /** When the event happened, in seconds on the Berkelium::monotonicTime
+     *  clock, or 0 to use the time it is injected. Passed on to the page
+     *  and used as the start of the input latency measurement. Of a run of
+     *  coalesced moves or wheel events, the page gets the last timestamp
+     *  and latency starts at the earliest one given.
+     */
+    double mTimestamp;
+
+    static InputEvent mouseMoved(int xPos, int yPos) {
+        InputEvent evt = make(MOUSE_MOVED);
+        evt.mX = xPos;
+        evt.mY = yPos;
+        return evt;
+    }
+    static InputEvent mouseButton(unsigned int buttonID, bool down) {
+        InputEvent evt = make(MOUSE_BUTTON);
+        evt.mButton = buttonID;
+        evt.mDown = down;
+        return evt;
+    }
+    static InputEvent mouseWheel(int xScroll, int yScroll) {
+        InputEvent evt = make(MOUSE_WHEEL);
+        evt.mX = xScroll;
+        evt.mY = yScroll;
+        return evt;
+    }
+    static InputEvent keyEvent(bool pressed, int mods, int vk_code,
+                               int scancode) {
+        InputEvent evt = make(KEY);
+        evt.mDown = pressed;
+        evt.mModifiers = mods;
+        evt.mVirtualKey = vk_code;
+        evt.mScancode = scancode;
+        return evt;
+    }
+    static InputEvent textEvent(const wchar_t *text, size_t textLength) {
+        InputEvent evt = make(TEXT);
+        evt.mText = text;
+        evt.mTextLength = textLength;
+        return evt;
+    }
+
+private:
+    static InputEvent make(Type type) {
+        InputEvent evt;
+        evt.mType = type;
+        evt.mX = 0;
+        evt.mY = 0;
+        evt.mButton = 0;
+        evt.mDown = false;
+        evt.mModifiers = 0;
+        evt.mVirtualKey = 0;
+        evt.mScancode = 0;
+        evt.mText = NULL;
+        evt.mTextLength = 0;
+        evt.mTimestamp = 0;
+        return evt;
+    }
+};
+
+}
+
+#endif
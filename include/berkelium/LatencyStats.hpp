@@ -0,0 +1,133 @@
+/*  Berkelium - Embedded Chromium
+ *  LatencyStats.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_LATENCY_STATS_HPP_
+#define _BERKELIUM_LATENCY_STATS_HPP_
+
+#include "berkelium/Platform.hpp"
+
+namespace Berkelium {
+
+/** Distribution of one latency, in buckets that double in width: bucket 0
+ *  counts samples under 1 ms, bucket i counts samples from 2^(i-1) ms up
+ *  to 2^i ms, and the last bucket counts everything slower.
+ */
+struct LatencyHistogram {
+    enum {
+        NUM_BUCKETS = 14
+    };
+    unsigned long mBuckets[NUM_BUCKETS];
+    unsigned long mCount;
+    unsigned long long mTotalMicroseconds;
+    unsigned long long mMaxMicroseconds;
+
+    LatencyHistogram() {
+        clear();
+    }
+    void clear() {
+        for (int i = 0; i < NUM_BUCKETS; ++i) {
+            mBuckets[i] = 0;
+        }
+        mCount = 0;
+        mTotalMicroseconds = 0;
+        mMaxMicroseconds = 0;
+    }
+    void addSample(unsigned long long microseconds) {
+        int bucket = 0;
+        for (unsigned long long limit = 1000;
+             microseconds >= limit && bucket < NUM_BUCKETS - 1;
+             limit *= 2) {
+            ++bucket;
+        }
+        ++mBuckets[bucket];
+        ++mCount;
+        mTotalMicroseconds += microseconds;
+        if (microseconds > mMaxMicroseconds) {
+            mMaxMicroseconds = microseconds;
+        }
+    }
+    /** Upper bound in milliseconds of the bucket holding the given
+     *  percentile (0 to 100), e.g. 99 for the p99 latency. Returns 0 if
+     *  there are no samples.
+     */
+    double percentileMilliseconds(double percentile) const {
+        if (!mCount) {
+            return 0;
+        }
+        const double wanted = mCount * percentile / 100.0;
+        unsigned long seen = 0;
+        double limit = 1;
+        for (int i = 0; i < NUM_BUCKETS - 1; ++i, limit *= 2) {
+            seen += mBuckets[i];
+            if (seen >= wanted) {
+                return limit;
+            }
+        }
+        return mMaxMicroseconds / 1000.0;
+    }
+};
+
+/** Time from an input event injected into a Window, such as
+ *  Window::mouseMoved or Window::keyEvent, to the paint showing its effect,
+ *  retrieved with Window::getLatencyStats.
+ *
+ *  Each event is timed from its injection to the renderer acknowledging
+ *  it, to the first paint arriving after that acknowledgement, and to the
+ *  WindowDelegate returning from that paint. Mouse moves and wheel events
+ *  that the browser coalesces while the renderer is busy are timed from
+ *  the first of them. Text inserted in one piece (see
+ *  Window::setBulkTextThreshold) is not timed, as the renderer does not
+ *  acknowledge it.
+ */
+struct LatencyStats {
+    /** Injection until the renderer has handled the event. */
+    LatencyHistogram mInputToHandled;
+    /** Injection until the next paint reached Berkelium. */
+    LatencyHistogram mInputToPaint;
+    /** Injection until the delegate returned from that paint. With a
+     *  FrameBatchDelegate this is when the paint was queued for the batch,
+     *  and while painting on demand when the frame holding it is handed
+     *  to the FrameCallback. Paints whose damage was all suppressed are
+     *  not presented.
+     */
+    LatencyHistogram mInputToPresent;
+
+    void clear() {
+        mInputToHandled.clear();
+        mInputToPaint.clear();
+        mInputToPresent.clear();
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*  Berkelium - Embedded Chromium
+ *  PaintStats.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_PAINT_STATS_HPP_
+#define _BERKELIUM_PAINT_STATS_HPP_
+
+#include "berkelium/Platform.hpp"
+
+namespace Berkelium {
+
+/** Counters describing the work done delivering paints for one Window,
+ *  retrieved with Window::getPaintStats. All counters only ever increase.
+ */
+struct PaintStats {
+    /** Number of paint messages received from the renderer. */
+    unsigned long mPaintCount;
+    /** Number of heap allocations made while handling those paints, such as
+     *  growing a scratch rect list or reallocating the canvas after a resize.
+     *  Once a Window has reached a steady state this no longer changes,
+     *  except for the one task per paint that hands it to a paint thread
+     *  (see setPaintThreads).
+     */
+    unsigned long mAllocationCount;
+    /** Bytes of damage passed to WindowDelegate::onPaint from the canvas,
+     *  in the Window's output format.
+     */
+    unsigned long long mDeliveredBytes;
+    /** Bytes of damage dropped because their pixels were unchanged, see
+     *  Window::setDamageSuppression.
+     */
+    unsigned long long mSuppressedBytes;
+
+    PaintStats()
+        : mPaintCount(0), mAllocationCount(0),
+          mDeliveredBytes(0), mSuppressedBytes(0) {
+    }
+    /** Adds the counters of other to these. */
+    void add(const PaintStats &other) {
+        mPaintCount += other.mPaintCount;
+        mAllocationCount += other.mAllocationCount;
+        mDeliveredBytes += other.mDeliveredBytes;
+        mSuppressedBytes += other.mSuppressedBytes;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*  Berkelium - Embedded Chromium
+ *  PixelFormat.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_PIXEL_FORMAT_HPP_
+#define _BERKELIUM_PIXEL_FORMAT_HPP_
+
+#include "berkelium/Platform.hpp"
+
+namespace Berkelium {
+
+/** Layouts a Window can deliver its canvas in, see Window::setOutputFormat.
+ *  Byte order is given as it appears in memory. Chromium renders
+ *  premultiplied BGRA; formats without alpha keep the premultiplied color,
+ *  which is the page composited over black.
+ */
+enum PixelFormat {
+    /** 4 bytes per pixel, premultiplied. The renderer's native format. */
+    PIXEL_FORMAT_BGRA,
+    /** 4 bytes per pixel, premultiplied. */
+    PIXEL_FORMAT_RGBA,
+    /** 4 bytes per pixel, straight alpha. */
+    PIXEL_FORMAT_BGRA_UNPREMULTIPLIED,
+    /** 4 bytes per pixel, straight alpha. */
+    PIXEL_FORMAT_RGBA_UNPREMULTIPLIED,
+    /** 3 bytes per pixel, no alpha. */
+    PIXEL_FORMAT_RGB24,
+    /** 2 bytes per pixel in a native-endian 16 bit word, red in the top
+     *  5 bits and blue in the bottom 5. No alpha.
+     */
+    PIXEL_FORMAT_RGB565
+};
+
+/** Returns the number of bytes one pixel of format takes up. */
+inline size_t pixelFormatBytesPerPixel(PixelFormat format) {
+    switch (format) {
+      case PIXEL_FORMAT_RGB24:
+        return 3;
+      case PIXEL_FORMAT_RGB565:
+        return 2;
+      default:
+        return 4;
+    }
+}
+
+}
+
+#endif
@@ -62,6 +62,35 @@ struct Rect {
         return (x >= left() && x < right() &&
                 y >= top() && y < bottom());
     }
+    /** True if this Rect covers no pixels. */
+    inline bool isEmpty() const {
+        return mWidth <= 0 || mHeight <= 0;
+    }
+    /** True if every pixel of rect also lies within this Rect. Empty rects
+     *  are contained by any Rect.
+     */
+    inline bool contains(const Rect &rect) const {
+        return rect.isEmpty() ||
+            (rect.left() >= left() && rect.right() <= right() &&
+             rect.top() >= top() && rect.bottom() <= bottom());
+    }
+    /** Returns the smallest Rect containing both this Rect and rect. Empty
+     *  rects are ignored.
+     */
+    Rect unite(const Rect &rect) const {
+        if (rect.isEmpty())
+            return *this;
+        if (isEmpty())
+            return rect;
+        int rx = rectmin(left(), rect.left());
+        int ry = rectmin(top(), rect.top());
+        Rect ret;
+        ret.mLeft = rx;
+        ret.mTop = ry;
+        ret.mWidth = rectmax(right(), rect.right()) - rx;
+        ret.mHeight = rectmax(bottom(), rect.bottom()) - ry;
+        return ret;
+    }
     Rect intersect(const Rect &rect) const {
         int rx = rectmax(left(), rect.left());
         int ry = rectmax(top(), rect.top());
@@ -0,0 +1,67 @@
+/*  Berkelium - Embedded Chromium
+ *  ResizePolicy.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_RESIZE_POLICY_HPP_
+#define _BERKELIUM_RESIZE_POLICY_HPP_
+
+#include "berkelium/Platform.hpp"
+
+namespace Berkelium {
+
+/** Controls how Window::resize reaches the renderer and how the library's
+ *  surfaces follow the page size, see Window::setResizePolicy.
+ *
+ *  Every size the renderer sees costs a relayout and a full repaint, so
+ *  while the application is drag-resizing a Window it is usually better to
+ *  only send the size it settles on.
+ */
+struct ResizePolicy {
+    /** How long resize() waits for another call before passing the latest
+     *  size on to the renderer, in milliseconds. Each call restarts the
+     *  wait. 0 sends every size straight away.
+     */
+    unsigned int mDebounceMilliseconds;
+    /** The canvas and converted output surfaces are allocated with each
+     *  dimension rounded up to a multiple of this many pixels. They never
+     *  shrink, so any size up to the largest seen so far, or within the
+     *  same multiple, reuses the existing memory. 1 allocates exactly.
+     */
+    unsigned int mSurfaceQuantum;
+
+    ResizePolicy()
+        : mDebounceMilliseconds(0), mSurfaceQuantum(1) {
+    }
+};
+
+}
+
+#endif
@@ -38,11 +38,22 @@
 #include "berkelium/WeakString.hpp"
 #include "berkelium/Context.hpp"
 #include "berkelium/Rect.hpp"
+#include "berkelium/PaintStats.hpp"
+#include "berkelium/LatencyStats.hpp"
+#include "berkelium/CoalescePolicy.hpp"
+#include "berkelium/ResizePolicy.hpp"
+#include "berkelium/InputEvent.hpp"
+#include "berkelium/PixelFormat.hpp"
+#include "berkelium/YuvFrame.hpp"
+#include "berkelium/DirtyTile.hpp"
 
 namespace Berkelium {
 
 class Widget;
 class WindowDelegate;
+class DeltaEncoder;
+class FrameCallback;
+class FrameExchange;
 
 enum KeyModifier {
     SHIFT_MOD      = 1 << 0,
@@ -165,6 +176,240 @@ public:
      */
     virtual void setTransparent(bool istrans)=0;
 
+    /** Reports which parts of each paint are fully opaque, through
+     *  WindowDelegate::onOpaqueRects, so that a transparent Window can be
+     *  drawn without blending wherever the page covers its background.
+     *  The alpha of every damaged row is scanned with SIMD compares. The
+     *  default PIXEL_FORMAT_BGRA output is premultiplied, so the remaining
+     *  area can use a (ONE, ONE_MINUS_SRC_ALPHA) blend. Has no effect
+     *  unless setCanvasEnabled is on.
+     * \param enabled  Whether to scan for opaque rects. Defaults to false.
+     */
+    virtual void setOpaqueDetection(bool enabled)=0;
+
+    /** Draws widgets such as select dropdowns into the canvas, on top of
+     *  the page in z-order, instead of passing them to onWidgetPaint. The
+     *  canvas then shows exactly what the user should see, and each onPaint
+     *  lists the damage from page and widgets alike, including the area a
+     *  destroyed widget uncovers. Widgets are drawn opaque. While enabled,
+     *  paints are applied on the UI thread even if paint threads are set.
+     *  Has no effect unless setCanvasEnabled is on.
+     * \param enabled  Whether to composite widgets. Defaults to false.
+     */
+    virtual void setWidgetCompositing(bool enabled)=0;
+
+    /** Enables leased frames for this Window and its Widgets. Instead of
+     *  onPaint and onWidgetPaint, the WindowDelegate receives onLeasedPaint
+     *  with a FrameLease pointing straight at the renderer's shared memory,
+     *  which stays valid until the lease is released. Leased paints do not
+     *  update the canvas, and setPaintOnDemand is ignored while leasing; a
+     *  pending requestFrame is dropped. Defaults to false.
+     * \param leased  Whether paints should be delivered as FrameLeases.
+     */
+    virtual void setLeasedFrames(bool leased)=0;
+
+    /** Shows or hides the Window. A hidden Window's renderer stops
+     *  painting, and once every Window sharing its process is hidden the
+     *  process runs at background priority. Showing the Window again
+     *  brings a full repaint. Defaults to visible.
+     * \param visible  Whether the Window is on screen.
+     */
+    virtual void setVisible(bool visible)=0;
+
+    /** Chooses whether hidden Windows free their canvas and the surfaces
+     *  derived from it, trading memory for a reallocation and a full
+     *  conversion when shown again. While released, getFrame returns NULL.
+     *  Defaults to false.
+     * \param release  Whether to free surfaces while hidden.
+     */
+    virtual void setReleaseSurfacesWhenHidden(bool release)=0;
+
+    /** Enables a library-maintained BGRA canvas holding the full contents of
+     *  this Window, so that applications do not need to keep their own copy.
+     *  While enabled, onPaint receives the canvas as its sourceBuffer, with
+     *  sourceBufferRect covering the whole Window, scrolling already applied
+     *  (dx and dy are 0) and copyRects listing every area that changed.
+     *  Widgets are not affected. Leased frames bypass the canvas.
+     *  Defaults to false.
+     * \param enabled  Whether to keep a canvas for this Window.
+     */
+    virtual void setCanvasEnabled(bool enabled)=0;
+
+    /** Returns the canvas maintained by setCanvasEnabled. The buffer is BGRA
+     *  with a stride of frameRect.width()*4 and is only valid until the next
+     *  call to Berkelium::update().
+     * \param frameRect  Receives the area covered by the canvas.
+     * \returns the canvas pixels, or NULL if the canvas is disabled or empty.
+     */
+    virtual const unsigned char *getFrame(Rect &frameRect) const=0;
+
+    /** Copies part of the canvas into an application buffer.
+     * \param region  Area of the Window to copy.
+     * \param dest  Buffer laid out to cover region, in BGRA.
+     * \param destStride  Bytes between rows of dest.
+     * \returns false if the canvas is disabled or region lies outside it.
+     */
+    virtual bool getFrameRegion(const Rect &region, unsigned char *dest,
+                                size_t destStride) const=0;
+
+    /** Retrieves every area of the canvas that changed since the last call
+     *  and resets the accumulated damage. Meant to be called once per
+     *  application frame.
+     * \param dirtyRects  Replaced with the list of changed rects.
+     */
+    virtual void drainDirtyRegion(std::vector<Rect> &dirtyRects)=0;
+
+    /** Tracks damage to the canvas as a grid of square tiles, for consumers
+     *  that upload or stream fixed-size blocks. Enabling tiles, or a resize
+     *  of the canvas, marks every tile dirty. Has no effect unless
+     *  setCanvasEnabled is on.
+     * \param tileSize  Width and height of a tile in pixels, e.g. 64, or 0
+     *     to stop tracking tiles (the default).
+     */
+    virtual void setTileSize(int tileSize)=0;
+
+    /** Retrieves every tile that changed since the last call and marks
+     *  them all clean again.
+     * \param dirtyTiles  Replaced with the dirty tiles in row-major order.
+     *     Passing the same vector every frame avoids reallocating it.
+     */
+    virtual void drainDirtyTiles(std::vector<DirtyTile> &dirtyTiles)=0;
+
+    /** Drops damage whose pixels are identical to what the canvas already
+     *  held, such as a caret blinking back to the same frame or a layout
+     *  invalidation that repaints the same content. Each damaged tile of
+     *  the canvas is hashed and compared against its previous hash, and
+     *  paints left with no damage are not delivered at all. The bytes
+     *  saved are reported in PaintStats::mSuppressedBytes. Has no effect
+     *  unless setCanvasEnabled is on.
+     * \param enabled  Whether to filter unchanged damage. Defaults to false.
+     */
+    virtual void setDamageSuppression(bool enabled)=0;
+
+    /** Keeps a downscaled copy of the canvas and passes it to
+     *  WindowDelegate::onThumbnailPaint after every paint that changes it,
+     *  and right away when its size changes. The thumbnail is a chain of half-size box-filtered levels, and only
+     *  the area under each paint's damage is filtered again. Has no effect
+     *  unless setCanvasEnabled is on.
+     * \param scaleShift  Thumbnail is 1/2^scaleShift of the page size
+     *     (1 to 8), or 0 to stop generating thumbnails (the default).
+     */
+    virtual void setThumbnailScale(int scaleShift)=0;
+
+    /** Like setThumbnailScale, but picks the largest 1/2^n scale that fits
+     *  within the given size, and picks again as the page is resized.
+     * \param maxWidth  Largest thumbnail width, or 0 to stop generating
+     *     thumbnails.
+     * \param maxHeight  Largest thumbnail height.
+     */
+    virtual void setThumbnailSize(int maxWidth, int maxHeight)=0;
+
+    /** Chooses the pixel format onPaint delivers the canvas in. Only the
+     *  damaged rects of each paint are converted, into a surface kept
+     *  alongside the canvas, so the buffer passed to onPaint is complete
+     *  and has a stride of width*pixelFormatBytesPerPixel(format). Has no
+     *  effect unless setCanvasEnabled is on; getFrame stays BGRA.
+     *  Defaults to PIXEL_FORMAT_BGRA.
+     * \param format  Format of the buffer passed to WindowDelegate::onPaint.
+     */
+    virtual void setOutputFormat(PixelFormat format)=0;
+
+    /** Keeps an I420 or NV12 copy of the canvas for a video encoder. Each
+     *  paint converts only the 16x16 macroblocks its damage touches, and
+     *  the macroblock rows that changed are collected for drainYuvFrame.
+     *  Has no effect unless setCanvasEnabled is on.
+     * \param format  Plane layout, or YUV_FORMAT_NONE to drop the YUV copy
+     *     (the default).
+     */
+    virtual void setYuvFormat(YuvFormat format)=0;
+
+    /** Retrieves the YUV planes along with every macroblock row changed
+     *  since the last call, and marks them all clean again.
+     * \param frame  Receives the planes.
+     * \param dirtyMacroblockRows  Replaced with the indices of the changed
+     *     16 pixel rows, in increasing order.
+     * \returns false if no YUV copy is kept (see setYuvFormat).
+     */
+    virtual bool drainYuvFrame(YuvFrame &frame,
+                               std::vector<int> &dirtyMacroblockRows)=0;
+
+    /** Limits how often this Window paints. The renderer is held back
+     *  until the next frame is due, and folds everything that changed in
+     *  the meantime into that frame, so a capped Window costs both less
+     *  renderer CPU and fewer, larger paints.
+     * \param framesPerSecond  Maximum paints per second, or 0 for no limit
+     *     (the default).
+     */
+    virtual void setMaxFrameRate(double framesPerSecond)=0;
+
+    /** Stops delivering paints until they are asked for with requestFrame.
+     *  The canvas still follows the page, but onPaint and the frame batch
+     *  are skipped and the renderer is held after each paint until the
+     *  next request, so an idle page costs no paints at all. Has no effect
+     *  unless setCanvasEnabled is on, or while setLeasedFrames is on, since
+     *  leased paints bypass the canvas. Defaults to false.
+     * \param enabled  Whether to deliver frames only on request.
+     */
+    virtual void setPaintOnDemand(bool enabled)=0;
+
+    /** Asks for one frame while painting on demand. The callback receives
+     *  the canvas along with all damage since the previous frame, from
+     *  within the next Berkelium::update(), or once the repaint arrives if
+     *  fullRepaint is set. A new request replaces one still pending.
+     * \param callback  Called once with the frame; owned by the caller.
+     * \param fullRepaint  Whether to have the renderer repaint the whole
+     *     page first, e.g. for the first frame of a job.
+     */
+    virtual void requestFrame(FrameCallback *callback, bool fullRepaint)=0;
+
+    /** Feeds every paint of the page into encoder, with the renderer's
+     *  scroll intact, whether or not the canvas is enabled. Paints are
+     *  encoded within Berkelium::update(); take the output afterwards with
+     *  DeltaEncoder::takeOutput. Use one encoder per Window, since paint
+     *  threads (see Berkelium::setPaintThreads) may encode Windows in
+     *  parallel. Paints delivered as leased frames are not encoded.
+     * \param encoder  Encoder owned by the caller, which must outlive this
+     *     Window or be replaced first, or NULL to stop encoding (the
+     *     default).
+     */
+    virtual void setDeltaEncoder(DeltaEncoder *encoder)=0;
+
+    /** Publishes every paint of the canvas to exchange, so another thread
+     *  can pick up the latest frame with FrameExchange::acquire. Frames are
+     *  published within Berkelium::update(), before onPaint, and whether or
+     *  not frame batching or painting on demand is in use. Has no effect
+     *  unless setCanvasEnabled is on.
+     * \param exchange  Exchange owned by the caller, which must outlive this
+     *     Window or be replaced first, or NULL to stop publishing (the
+     *     default). Setting it publishes the current canvas right away.
+     */
+    virtual void setFrameExchange(FrameExchange *exchange)=0;
+
+    /** Chooses how the copy rects of each paint are merged or split before
+     *  reaching WindowDelegate::onPaint and onWidgetPaint. Defaults to
+     *  CoalescePolicy::COALESCE_NONE.
+     * \param policy  Strategy and cost parameters; see CoalescePolicy.
+     */
+    virtual void setCoalescePolicy(const CoalescePolicy &policy)=0;
+
+    /** Retrieves counters describing paint delivery for this Window. Useful
+     *  for checking that a long-running Window has stopped allocating.
+     * \param stats  Receives the current counters.
+     */
+    virtual void getPaintStats(PaintStats &stats) const=0;
+
+    /** Retrieves histograms of the time from injected input events to the
+     *  paints that show them, across the page and its widgets.
+     * \param stats  Receives the histograms collected since the Window was
+     *     created or resetLatencyStats was last called.
+     */
+    virtual void getLatencyStats(LatencyStats &stats) const=0;
+
+    /** Clears the histograms returned by getLatencyStats, e.g. at the start
+     *  of a measurement interval.
+     */
+    virtual void resetLatencyStats()=0;
+
     /** Set the topmost Widget for this Window as focused.
      */
     virtual void focus()=0;
@@ -196,6 +441,16 @@ public:
      */
     virtual void textEvent(const wchar_t *evt, size_t evtLength)=0;
 
+    /** Sets how long a textEvent must be before it is committed in one
+     *  message, the way an input method commits text, instead of as one
+     *  key event per character. Bulk commits only apply while a text field
+     *  has focus, and fire input events but no keydown or keypress. Text
+     *  sent to anything else is always typed one character at a time.
+     *  \param utf16Length  Length in UTF-16 code units from which text is
+     *         committed in bulk, or 0 to always type it. Defaults to 256.
+     */
+    virtual void setBulkTextThreshold(size_t utf16Length)=0;
+
     /** Inject an individual key event into the Window.
      *  \param pressed if true indicates the key was pressed, if false indicates
      *         it was released
@@ -205,6 +460,18 @@ public:
      */
     virtual void keyEvent(bool pressed, int mods, int vk_code, int scancode)=0;
 
+    /** Injects a batch of input events, e.g. a burst received from a remote
+     *  client. Each run of consecutive MOUSE_MOVED events is sent as its
+     *  last move only, and each run of consecutive MOUSE_WHEEL events as a
+     *  single wheel event scrolling by their sum. Every other event is sent
+     *  as is, and the order of the events that remain is kept, so buttons,
+     *  keys and text always see the pointer where the batch left it.
+     *  Coalesced events carry the mTimestamp of the last event of the run.
+     *  \param events  Array of numEvents events, only read during the call.
+     *  \returns the number of events sent to the page after coalescing.
+     */
+    virtual size_t injectInput(const InputEvent *events, size_t numEvents)=0;
+
 
     /** Resize the Window. You should receive an onPaint message as an
      *  acknowledgement.
@@ -213,6 +480,14 @@ public:
      */
     virtual void resize(int width, int height)=0;
 
+    /** Chooses how resize() calls are passed on to the renderer and how
+     *  the canvas follows the new size. Setting a policy without a
+     *  debounce sends any size still waiting right away.
+     * \param policy  Debounce interval and surface quantum; see
+     *     ResizePolicy.
+     */
+    virtual void setResizePolicy(const ResizePolicy &policy)=0;
+
     /** Changes the zoom level of the page in fixed increments (same as
      *  Ctrl--, Ctrl-0, and Ctrl-+ in most browsers.
      * \param mode  -1 to zoom out, 0 to reset zoom, 1 to zoom in
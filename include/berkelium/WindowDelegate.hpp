@@ -41,6 +41,7 @@ class WindowImpl;
 class Widget;
 class Window;
 class Cursor;
+class FrameLease;
 
 /**
  * Holds parameters for the onContextMenu delegate method.
@@ -273,7 +274,9 @@ public:
      * into application (video) memory before returning.
      *
      * \param win  Window instance that fired this event.
-     * \param sourceBuffer  BGRA buffer with width/height of sourceBufferRect.
+     * \param sourceBuffer  BGRA buffer with width/height of sourceBufferRect,
+     *     or the format chosen with Window::setOutputFormat when the canvas
+     *     is enabled.
      * \param sourceBufferRect  Rect containing the buffer.
      * \param numCopyRects  Length of copyRects.
      * \param copyRects  Array of valid+changed rectangles of sourceBuffer.
@@ -295,6 +298,54 @@ public:
         int dx, int dy,
         const Rect &scrollRect) {}
 
+    /**
+     * The window or one of its widgets has been painted while leased frames
+     * are enabled (see Window::setLeasedFrames). This replaces onPaint and
+     * onWidgetPaint. The lease is only guaranteed to live until this call
+     * returns; call lease->addRef() to keep the buffer for longer, and
+     * release() it once done, from any thread.
+     *
+     * \param win  Window instance that fired this event.
+     * \param wid  Widget this paint is for, or NULL for the Window itself.
+     * \param lease  Renderer buffer along with the usual paint parameters.
+     */
+    virtual void onLeasedPaint(Window *win, Widget *wid, FrameLease *lease) {}
+
+    /**
+     * The thumbnail requested with Window::setThumbnailScale or
+     * Window::setThumbnailSize has changed. Called just before the matching
+     * onPaint, or from within the call that changed the thumbnail size.
+     *
+     * \param win  Window instance that fired this event.
+     * \param thumbnail  BGRA buffer with a stride of thumbnailRect.width()*4,
+     *     valid until the next call to Berkelium::update().
+     * \param thumbnailRect  Size of the thumbnail.
+     * \param numDirtyRects  Length of dirtyRects.
+     * \param dirtyRects  Areas of thumbnail changed since the last call.
+     */
+    virtual void onThumbnailPaint(
+        Window *win,
+        const unsigned char *thumbnail,
+        const Rect &thumbnailRect,
+        size_t numDirtyRects,
+        const Rect *dirtyRects) {}
+
+    /**
+     * Lists the parts of the coming paint that are fully opaque, when
+     * enabled with Window::setOpaqueDetection. Called just before the
+     * matching onPaint, or before the paint is queued for the
+     * FrameBatchDelegate.
+     *
+     * \param win  Window instance that fired this event.
+     * \param numOpaqueRects  Length of opaqueRects.
+     * \param opaqueRects  Areas of the paint's copyRects whose pixels all
+     *     have an alpha of 255, made of whole rows of each copy rect.
+     */
+    virtual void onOpaqueRects(
+        Window *win,
+        size_t numOpaqueRects,
+        const Rect *opaqueRects) {}
+
     /**
      * A widget is a rectangle to display on top of the page, e.g. a context
      * menu or a dropdown.
@@ -0,0 +1,78 @@
+/*  Berkelium - Embedded Chromium
+ *  YuvFrame.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_YUV_FRAME_HPP_
+#define _BERKELIUM_YUV_FRAME_HPP_
+
+#include "berkelium/Platform.hpp"
+
+namespace Berkelium {
+
+/** Planar layouts a Window can keep a video-ready copy of its canvas in,
+ *  see Window::setYuvFormat. Both use BT.601 limited range (Y 16-235,
+ *  U/V 16-240) with 2x2 subsampled chroma, taken from the page composited
+ *  over black.
+ */
+enum YuvFormat {
+    YUV_FORMAT_NONE,
+    /** Y plane, then a U plane and a V plane at half width and height. */
+    YUV_FORMAT_I420,
+    /** Y plane, then one half height plane of interleaved U, V pairs. */
+    YUV_FORMAT_NV12
+};
+
+/** Planes of a Window's YUV surface, see Window::drainYuvFrame. The planes
+ *  are padded to whole 16x16 macroblocks by repeating the right and bottom
+ *  edges of the page, and stay valid until the next call to
+ *  Berkelium::update().
+ */
+struct YuvFrame {
+    YuvFormat mFormat;
+    /** Size of the page. */
+    int mWidth;
+    int mHeight;
+    /** Size of the Y plane, mWidth and mHeight rounded up to 16. */
+    int mCodedWidth;
+    int mCodedHeight;
+    const unsigned char *mY;
+    size_t mYStride;
+    /** U plane for I420, interleaved UV plane for NV12. */
+    const unsigned char *mU;
+    /** V plane for I420, NULL for NV12. */
+    const unsigned char *mV;
+    /** Stride of mU, and of mV for I420. */
+    size_t mUVStride;
+};
+
+}
+
+#endif
@@ -32,6 +32,7 @@
 
 #include "berkelium/Berkelium.hpp"
 #include "Root.hpp"
+#include "base/time.h"
 
 namespace Berkelium {
 
@@ -49,5 +50,14 @@ void update () {
 void setErrorHandler (ErrorDelegate *errorHandler) {
     Root::getSingleton().setErrorHandler(errorHandler);
 }
+void setPaintThreads (unsigned int numThreads) {
+    Root::getSingleton().setPaintThreads(numThreads);
+}
+void setFrameBatchDelegate (FrameBatchDelegate *delegate) {
+    Root::getSingleton().setFrameBatchDelegate(delegate);
+}
+double monotonicTime () {
+    return (base::TimeTicks::HighResNow() - base::TimeTicks()).InSecondsF();
+}
 
 }
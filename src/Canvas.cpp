@@ -0,0 +1,186 @@
+/*  Berkelium Implementation
+ *  Canvas.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Canvas.hpp"
+
+#include <string.h>
+
+namespace Berkelium {
+
+Canvas::Canvas() {
+    mData = NULL;
+    mCapacity = 0;
+    mQuantum = 1;
+    mWidth = 0;
+    mHeight = 0;
+}
+
+Canvas::~Canvas() {
+    delete []mData;
+}
+
+Rect Canvas::rect() const {
+    Rect ret;
+    ret.mLeft = 0;
+    ret.mTop = 0;
+    ret.mWidth = mWidth;
+    ret.mHeight = mHeight;
+    return ret;
+}
+
+bool Canvas::resize(int width, int height) {
+    if (width < 0) width = 0;
+    if (height < 0) height = 0;
+    const size_t needed = (size_t)width * kBytesPerPixel * height;
+    bool allocated = false;
+    if (needed > mCapacity) {
+        delete []mData;
+        const size_t quantizedWidth =
+            ((size_t)width + mQuantum - 1) / mQuantum * mQuantum;
+        const size_t quantizedHeight =
+            ((size_t)height + mQuantum - 1) / mQuantum * mQuantum;
+        mCapacity = quantizedWidth * kBytesPerPixel * quantizedHeight;
+        mData = new unsigned char[mCapacity];
+        allocated = true;
+    }
+    mWidth = width;
+    mHeight = height;
+    if (needed) {
+        memset(mData, 0, needed);
+    }
+    return allocated;
+}
+
+void Canvas::release() {
+    delete []mData;
+    mData = NULL;
+    mCapacity = 0;
+    mWidth = 0;
+    mHeight = 0;
+}
+
+void Canvas::setSizeQuantum(int quantum) {
+    mQuantum = quantum > 1 ? quantum : 1;
+}
+
+void Canvas::blit(const unsigned char *source, const Rect &sourceRect,
+                  size_t numRects, const Rect *rects) {
+    const Rect bounds = rect().intersect(sourceRect);
+    const size_t sourceStride = (size_t)sourceRect.width() * kBytesPerPixel;
+    for (size_t i = 0; i < numRects; ++i) {
+        Rect r = rects[i].intersect(bounds);
+        if (r.width() <= 0 || r.height() <= 0) {
+            continue;
+        }
+        const size_t rowBytes = (size_t)r.width() * kBytesPerPixel;
+        const unsigned char *src = source +
+            (r.top() - sourceRect.top()) * sourceStride +
+            (r.left() - sourceRect.left()) * kBytesPerPixel;
+        unsigned char *dst = mData + r.top() * stride() +
+            r.left() * kBytesPerPixel;
+        for (int y = 0; y < r.height(); ++y) {
+            memcpy(dst, src, rowBytes);
+            src += sourceStride;
+            dst += stride();
+        }
+    }
+}
+
+Rect Canvas::scroll(int dx, int dy, const Rect &scrollRect) {
+    if (!data() || (dx == 0 && dy == 0)) {
+        return Rect();
+    }
+    const Rect clip = scrollRect.intersect(rect());
+    // The destination of the move is the part of the clip rect that is still
+    // covered after translating it.
+    const Rect dest = clip.intersect(clip.translate(dx, dy));
+    if (dest.isEmpty()) {
+        return Rect();
+    }
+    const size_t rowBytes = (size_t)dest.width() * kBytesPerPixel;
+    unsigned char *dstStart = mData + dest.top() * stride() +
+        dest.left() * kBytesPerPixel;
+    const unsigned char *srcStart = dstStart -
+        (dy * (long)stride() + dx * kBytesPerPixel);
+
+    if (dx == 0 && dest.width() == mWidth) {
+        // Full-width vertical scroll, the common case for a page: the rows
+        // are contiguous, so the whole move is a single block move.
+        memmove(dstStart, srcStart, rowBytes * dest.height());
+        return dest;
+    }
+    if (dy == 0) {
+        // Horizontal scroll: source and destination share each row.
+        for (int y = 0; y < dest.height(); ++y) {
+            memmove(dstStart, srcStart, rowBytes);
+            dstStart += stride();
+            srcStart += stride();
+        }
+        return dest;
+    }
+    // Source and destination rows never coincide, so each row is a plain
+    // copy. Moving down walks bottom-up so source rows are read before they
+    // are overwritten.
+    long step = (long)stride();
+    if (dy > 0) {
+        dstStart += (dest.height() - 1) * step;
+        srcStart += (dest.height() - 1) * step;
+        step = -step;
+    }
+    for (int y = 0; y < dest.height(); ++y) {
+        memcpy(dstStart, srcStart, rowBytes);
+        dstStart += step;
+        srcStart += step;
+    }
+    return dest;
+}
+
+bool Canvas::copyTo(const Rect &region, unsigned char *dest,
+                    size_t destStride) const {
+    const Rect r = region.intersect(rect());
+    if (!data() || r.width() <= 0 || r.height() <= 0) {
+        return false;
+    }
+    const size_t rowBytes = (size_t)r.width() * kBytesPerPixel;
+    const unsigned char *src = mData + r.top() * stride() +
+        r.left() * kBytesPerPixel;
+    dest += (r.top() - region.top()) * destStride +
+        (r.left() - region.left()) * kBytesPerPixel;
+    for (int y = 0; y < r.height(); ++y) {
+        memcpy(dest, src, rowBytes);
+        src += stride();
+        dest += destStride;
+    }
+    return true;
+}
+
+}
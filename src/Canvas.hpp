@@ -0,0 +1,115 @@
+/*  Berkelium Implementation
+ *  Canvas.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_CANVAS_HPP_
+#define _BERKELIUM_CANVAS_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+
+namespace Berkelium {
+
+// A full-size BGRA copy of a page, kept up to date from the renderer's partial
+// paints so that embedders do not each need their own shadow buffer.
+// Rows are tightly packed: stride() is always width() * 4.
+class Canvas {
+public:
+    static const int kBytesPerPixel = 4;
+
+    Canvas();
+    ~Canvas();
+
+    // Changes the size of the canvas. Contents are cleared to transparent
+    // black, since the renderer sends a full repaint after every resize.
+    // Memory is only ever grown, so shrinking and growing back again reuses
+    // the same buffer. Returns true if a new buffer was allocated.
+    bool resize(int width, int height);
+
+    // Frees the pixels, leaving an empty canvas.
+    void release();
+
+    // Rounds each dimension of future allocations up to a multiple of
+    // |quantum| pixels, so that small size changes fit in spare capacity.
+    void setSizeQuantum(int quantum);
+
+    int width() const {
+        return mWidth;
+    }
+    int height() const {
+        return mHeight;
+    }
+    size_t stride() const {
+        return (size_t)mWidth * kBytesPerPixel;
+    }
+    Rect rect() const;
+
+    // NULL while the canvas is empty, even if memory is still held.
+    const unsigned char *data() const {
+        return mWidth && mHeight ? mData : NULL;
+    }
+    unsigned char *data() {
+        return mWidth && mHeight ? mData : NULL;
+    }
+
+    // Copies the given rects out of |source|, a buffer covering |sourceRect|
+    // with a stride of sourceRect.width() * 4. Rects are clipped to both the
+    // source and the canvas.
+    void blit(const unsigned char *source, const Rect &sourceRect,
+              size_t numRects, const Rect *rects);
+
+    // Moves the pixels inside |scrollRect| by (dx, dy). Pixels shifted out of
+    // the rect are discarded; the exposed strip keeps stale data until the
+    // renderer's copy rects are blitted over it. Returns the area that
+    // received shifted pixels, or an empty rect if nothing moved.
+    Rect scroll(int dx, int dy, const Rect &scrollRect);
+
+    // Copies |region| into |dest|, which is laid out as a buffer covering
+    // |region|. Parts of |region| outside the canvas are left untouched.
+    // Returns false if nothing was copied.
+    bool copyTo(const Rect &region, unsigned char *dest,
+                size_t destStride) const;
+
+private:
+    Canvas(const Canvas&);
+    Canvas &operator=(const Canvas&);
+
+    unsigned char *mData;
+    // Bytes allocated at mData.
+    size_t mCapacity;
+    int mQuantum;
+    int mWidth;
+    int mHeight;
+};
+
+}
+
+#endif
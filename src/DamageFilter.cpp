@@ -0,0 +1,186 @@
+/*  Berkelium Implementation
+ *  DamageFilter.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DamageFilter.hpp"
+#include "Canvas.hpp"
+#include "DirtyRegion.hpp"
+
+#include <string.h>
+
+namespace Berkelium {
+
+namespace {
+
+const unsigned long long kPrime1 = 0x9E3779B185EBCA87ULL;
+const unsigned long long kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+inline unsigned long long rotl(unsigned long long v, int bits) {
+    return (v << bits) | (v >> (64 - bits));
+}
+
+inline unsigned long long mixLane(unsigned long long acc,
+                                  const unsigned char *p) {
+    unsigned long long v;
+    memcpy(&v, p, sizeof(v));
+    return rotl(acc + v * kPrime2, 31) * kPrime1;
+}
+
+// xxHash64-style hash over a block of rows. Four independent lanes let the
+// multiplies of one 32 byte step overlap, which is what makes it fast; no
+// byte-level precision is needed since collisions only cost a missed repaint
+// of identical-hashing content.
+unsigned long long hashBlock(const unsigned char *data, size_t stride,
+                             size_t rowBytes, int rows) {
+    unsigned long long lane0 = kPrime1 + kPrime2;
+    unsigned long long lane1 = kPrime2;
+    unsigned long long lane2 = 0;
+    unsigned long long lane3 = 0 - kPrime1;
+    unsigned long long tail = rowBytes * kPrime1 + rows;
+    for (int y = 0; y < rows; ++y, data += stride) {
+        size_t x = 0;
+        for (; x + 32 <= rowBytes; x += 32) {
+            lane0 = mixLane(lane0, data + x);
+            lane1 = mixLane(lane1, data + x + 8);
+            lane2 = mixLane(lane2, data + x + 16);
+            lane3 = mixLane(lane3, data + x + 24);
+        }
+        for (; x + 8 <= rowBytes; x += 8) {
+            tail = mixLane(tail, data + x);
+        }
+        for (; x < rowBytes; ++x) {
+            tail = rotl(tail ^ (data[x] * kPrime1), 11) * kPrime2;
+        }
+    }
+    unsigned long long h = rotl(lane0, 1) + rotl(lane1, 7) +
+        rotl(lane2, 12) + rotl(lane3, 18) + tail;
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    return h;
+}
+
+}
+
+DamageFilter::DamageFilter(int tileSize) {
+    mTileSize = tileSize > 0 ? tileSize : kDefaultTileSize;
+}
+
+void DamageFilter::reset() {
+    mTouched.reset(0, 0, mTileSize);
+    mHashes.clear();
+    mHashValid.clear();
+}
+
+long long DamageFilter::filter(const Canvas &canvas,
+                               const DirtyRegion &damage,
+                               DirtyRegion &out) {
+    if (mTouched.width() != canvas.width() ||
+        mTouched.height() != canvas.height()) {
+        mTouched.reset(canvas.width(), canvas.height(), mTileSize);
+        mHashes.assign(mTouched.tileCount(), 0);
+        mHashValid.assign(mTouched.tileCount(), false);
+    }
+    mChanged.reset(canvas.width(), canvas.height(), mTileSize);
+    mTouched.clear();
+    const Rect *rects = damage.rects();
+    for (size_t i = 0; i < damage.size(); ++i) {
+        mTouched.markRect(rects[i]);
+    }
+
+    for (size_t tile = mTouched.nextDirty(0);
+         tile < mTouched.tileCount();
+         tile = mTouched.nextDirty(tile + 1)) {
+        const Rect r = mTouched.tileRect(tile);
+        unsigned long long hash = hashBlock(
+            canvas.data() + r.top() * canvas.stride() +
+                r.left() * Canvas::kBytesPerPixel,
+            canvas.stride(),
+            (size_t)r.width() * Canvas::kBytesPerPixel,
+            r.height());
+        if (!mHashValid[tile] || mHashes[tile] != hash) {
+            mHashes[tile] = hash;
+            mHashValid[tile] = true;
+            mChanged.markRect(r);
+        }
+    }
+
+    // Rebuild the damage from runs of changed tiles along each tile row,
+    // so that a fully changed rect comes back out as a single rect rather
+    // than one per tile.
+    const Rect bounds = canvas.rect();
+    long long suppressed = 0;
+    for (size_t i = 0; i < damage.size(); ++i) {
+        const Rect r = rects[i].intersect(bounds);
+        if (r.isEmpty()) {
+            continue;
+        }
+        const int firstColumn = r.left() / mTileSize;
+        const int lastColumn = (r.right() - 1) / mTileSize;
+        const int firstRow = r.top() / mTileSize;
+        const int lastRow = (r.bottom() - 1) / mTileSize;
+        Rect pending = Rect();
+        for (int row = firstRow; row <= lastRow; ++row) {
+            const size_t rowStart = (size_t)row * mChanged.columns();
+            int column = firstColumn;
+            while (column <= lastColumn) {
+                const bool changed = mChanged.isDirty(rowStart + column);
+                int runEnd = column;
+                while (runEnd < lastColumn &&
+                       mChanged.isDirty(rowStart + runEnd + 1) == changed) {
+                    ++runEnd;
+                }
+                Rect piece = r.intersect(
+                    mChanged.tileRect(rowStart + column).unite(
+                        mChanged.tileRect(rowStart + runEnd)));
+                if (changed) {
+                    // Grow the previous piece downwards where the runs of
+                    // consecutive tile rows line up.
+                    if (pending.left() == piece.left() &&
+                        pending.width() == piece.width() &&
+                        pending.bottom() == piece.top()) {
+                        pending.mHeight += piece.height();
+                    } else {
+                        out.add(pending);
+                        pending = piece;
+                    }
+                } else {
+                    suppressed += (long long)piece.width() * piece.height();
+                }
+                column = runEnd + 1;
+            }
+        }
+        out.add(pending);
+    }
+    return suppressed;
+}
+
+}
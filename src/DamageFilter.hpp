@@ -0,0 +1,75 @@
+/*  Berkelium Implementation
+ *  DamageFilter.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_DAMAGEFILTER_HPP_
+#define _BERKELIUM_DAMAGEFILTER_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+#include "TileGrid.hpp"
+#include <vector>
+
+namespace Berkelium {
+
+class Canvas;
+class DirtyRegion;
+
+// Drops damage whose pixels did not actually change. Keeps a 64 bit hash of
+// every tile of the canvas; after a paint the tiles touched by the damage
+// are rehashed, and only damage inside tiles whose hash changed is kept.
+class DamageFilter {
+public:
+    static const int kDefaultTileSize = 32;
+
+    explicit DamageFilter(int tileSize = kDefaultTileSize);
+
+    // Forgets all hashes, e.g. after the canvas was resized. Every tile is
+    // treated as changed the next time it is damaged.
+    void reset();
+
+    // Adds to |out| the parts of |damage| that lie in changed tiles of
+    // |canvas|, and returns the number of damaged pixels that were dropped.
+    long long filter(const Canvas &canvas, const DirtyRegion &damage,
+                     DirtyRegion &out);
+
+private:
+    int mTileSize;
+    // Tiles touched by the current damage, then tiles that really changed.
+    TileGrid mTouched;
+    TileGrid mChanged;
+    std::vector<unsigned long long> mHashes;
+    std::vector<bool> mHashValid;
+};
+
+}
+
+#endif
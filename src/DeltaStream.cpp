@@ -0,0 +1,382 @@
+/*  Berkelium Implementation
+ *  DeltaStream.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "berkelium/DeltaStream.hpp"
+#include "Canvas.hpp"
+
+#include <string.h>
+
+namespace Berkelium {
+
+namespace {
+
+enum DeltaOp {
+    OP_FRAME = 'F',
+    OP_SCROLL = 'S',
+    OP_RECT = 'R',
+    OP_END = 'E'
+};
+
+enum DeltaCodec {
+    CODEC_RAW = 0,
+    CODEC_RLE = 1
+};
+
+const int kMaxLiteral = 128;
+const int kMinRun = 2;
+const int kMaxRun = 129;
+// Largest frame side the decoder accepts, so a corrupt stream cannot make
+// it allocate without bound.
+const int kMaxFrameSide = 8192;
+
+inline unsigned int loadPixel(const unsigned char *p) {
+    unsigned int pixel;
+    memcpy(&pixel, p, 4);
+    return pixel;
+}
+
+void putByte(std::vector<unsigned char> &out, unsigned char value) {
+    out.push_back(value);
+}
+
+void putInt(std::vector<unsigned char> &out, unsigned int value) {
+    out.push_back((unsigned char)value);
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 24));
+}
+
+void putRect(std::vector<unsigned char> &out, const Rect &rect) {
+    putInt(out, rect.left());
+    putInt(out, rect.top());
+    putInt(out, rect.width());
+    putInt(out, rect.height());
+}
+
+// Run-length codes |count| pixels, see DeltaEncoder for the packet layout.
+// Gives up and returns false once the output would be larger than raw.
+bool rleEncode(const unsigned char *pixels, size_t count,
+               std::vector<unsigned char> &out) {
+    const size_t rawBytes = count * 4;
+    out.clear();
+    size_t literalStart = 0;
+    size_t literalCount = 0;
+    size_t i = 0;
+    while (i < count) {
+        const unsigned int pixel = loadPixel(pixels + i * 4);
+        size_t run = 1;
+        while (i + run < count && run < (size_t)kMaxRun &&
+               loadPixel(pixels + (i + run) * 4) == pixel) {
+            ++run;
+        }
+        if (run >= (size_t)kMinRun || literalCount == (size_t)kMaxLiteral) {
+            if (literalCount) {
+                out.push_back((unsigned char)(literalCount - 1));
+                out.insert(out.end(), pixels + literalStart * 4,
+                           pixels + (literalStart + literalCount) * 4);
+                literalCount = 0;
+            }
+        }
+        if (run >= (size_t)kMinRun) {
+            out.push_back((unsigned char)(0x80 | (run - kMinRun)));
+            out.insert(out.end(), pixels + i * 4, pixels + i * 4 + 4);
+            i += run;
+        } else {
+            if (!literalCount) {
+                literalStart = i;
+            }
+            ++literalCount;
+            ++i;
+        }
+        if (out.size() >= rawBytes) {
+            return false;
+        }
+    }
+    if (literalCount) {
+        out.push_back((unsigned char)(literalCount - 1));
+        out.insert(out.end(), pixels + literalStart * 4,
+                   pixels + (literalStart + literalCount) * 4);
+    }
+    return out.size() < rawBytes;
+}
+
+bool rleDecode(const unsigned char *in, size_t size,
+               unsigned char *pixels, size_t count) {
+    const unsigned char *end = in + size;
+    size_t i = 0;
+    while (in < end) {
+        const unsigned char packet = *in++;
+        if (packet & 0x80) {
+            const size_t run = (packet & 0x7f) + kMinRun;
+            if (end - in < 4 || run > count - i) {
+                return false;
+            }
+            for (size_t j = 0; j < run; ++j) {
+                memcpy(pixels + (i + j) * 4, in, 4);
+            }
+            in += 4;
+            i += run;
+        } else {
+            const size_t literal = packet + 1;
+            if ((size_t)(end - in) < literal * 4 || literal > count - i) {
+                return false;
+            }
+            memcpy(pixels + i * 4, in, literal * 4);
+            in += literal * 4;
+            i += literal;
+        }
+    }
+    return i == count;
+}
+
+// Checks |rect| against a width x height frame without overflowing.
+bool fitsIn(const Rect &rect, int width, int height) {
+    return rect.left() >= 0 && rect.top() >= 0 &&
+        rect.width() > 0 && rect.height() > 0 &&
+        rect.width() <= width - rect.left() &&
+        rect.height() <= height - rect.top();
+}
+
+class Reader {
+public:
+    Reader(const unsigned char *data, size_t size)
+        : mPos(data), mEnd(data + size) {
+    }
+    bool atEnd() const {
+        return mPos == mEnd;
+    }
+    bool readByte(unsigned char &value) {
+        if (mPos == mEnd) {
+            return false;
+        }
+        value = *mPos++;
+        return true;
+    }
+    bool readInt(int &value) {
+        if (mEnd - mPos < 4) {
+            return false;
+        }
+        value = (int)(mPos[0] | (mPos[1] << 8) | (mPos[2] << 16) |
+                      ((unsigned int)mPos[3] << 24));
+        mPos += 4;
+        return true;
+    }
+    bool readRect(Rect &rect) {
+        return readInt(rect.mLeft) && readInt(rect.mTop) &&
+            readInt(rect.mWidth) && readInt(rect.mHeight);
+    }
+    bool readBytes(size_t size, const unsigned char *&bytes) {
+        if ((size_t)(mEnd - mPos) < size) {
+            return false;
+        }
+        bytes = mPos;
+        mPos += size;
+        return true;
+    }
+private:
+    const unsigned char *mPos;
+    const unsigned char *mEnd;
+};
+
+}
+
+DeltaEncoder::DeltaEncoder()
+    : mInputBytes(0), mOutputBytes(0) {
+}
+
+void DeltaEncoder::encodePaint(int viewWidth, int viewHeight,
+                               const unsigned char *sourceBuffer,
+                               const Rect &sourceBufferRect,
+                               size_t numCopyRects, const Rect *copyRects,
+                               int dx, int dy, const Rect &scrollRect) {
+    const size_t startSize = mOutput.size();
+    putByte(mOutput, OP_FRAME);
+    putInt(mOutput, viewWidth);
+    putInt(mOutput, viewHeight);
+    Rect view = Rect();
+    view.mWidth = viewWidth;
+    view.mHeight = viewHeight;
+    const Rect scrollClip = scrollRect.intersect(view);
+    if ((dx || dy) && !scrollClip.isEmpty()) {
+        putByte(mOutput, OP_SCROLL);
+        putRect(mOutput, scrollClip);
+        putInt(mOutput, dx);
+        putInt(mOutput, dy);
+    }
+    for (size_t i = 0; i < numCopyRects; ++i) {
+        encodeRect(sourceBuffer, sourceBufferRect, copyRects[i]);
+    }
+    putByte(mOutput, OP_END);
+    mOutputBytes += mOutput.size() - startSize;
+}
+
+void DeltaEncoder::encodeRect(const unsigned char *sourceBuffer,
+                              const Rect &sourceBufferRect,
+                              const Rect &rect) {
+    const Rect r = rect.intersect(sourceBufferRect);
+    if (r.isEmpty()) {
+        return;
+    }
+    const size_t rowBytes = (size_t)r.width() * 4;
+    const size_t sourceStride = (size_t)sourceBufferRect.width() * 4;
+    const unsigned char *first = sourceBuffer +
+        (r.top() - sourceBufferRect.top()) * sourceStride +
+        (r.left() - sourceBufferRect.left()) * 4;
+    mInputBytes += rowBytes * r.height();
+
+    putByte(mOutput, OP_RECT);
+    putRect(mOutput, r);
+    const unsigned char *block = first;
+    if (rowBytes != sourceStride) {
+        // Runs may continue across rows, so code the rect as one block.
+        mBlock.resize(rowBytes * r.height());
+        for (int y = 0; y < r.height(); ++y) {
+            memcpy(&mBlock[y * rowBytes], first + y * sourceStride,
+                   rowBytes);
+        }
+        block = &mBlock[0];
+    }
+    const bool compressed = rleEncode(
+        block, (size_t)r.width() * r.height(), mPayload);
+    putByte(mOutput, compressed ? CODEC_RLE : CODEC_RAW);
+    if (compressed) {
+        putInt(mOutput, (unsigned int)mPayload.size());
+        mOutput.insert(mOutput.end(), mPayload.begin(), mPayload.end());
+    } else {
+        putInt(mOutput, (unsigned int)(rowBytes * r.height()));
+        for (int y = 0; y < r.height(); ++y) {
+            mOutput.insert(mOutput.end(), first + y * sourceStride,
+                           first + y * sourceStride + rowBytes);
+        }
+    }
+}
+
+void DeltaEncoder::takeOutput(std::vector<unsigned char> &out) {
+    out.clear();
+    out.swap(mOutput);
+}
+
+DeltaDecoder::DeltaDecoder()
+    : mCanvas(new Canvas) {
+}
+
+DeltaDecoder::~DeltaDecoder() {
+    delete mCanvas;
+}
+
+int DeltaDecoder::width() const {
+    return mCanvas->width();
+}
+
+int DeltaDecoder::height() const {
+    return mCanvas->height();
+}
+
+const unsigned char *DeltaDecoder::data() const {
+    return mCanvas->data();
+}
+
+bool DeltaDecoder::decode(const unsigned char *data, size_t size) {
+    Reader reader(data, size);
+    bool inFrame = false;
+    while (!reader.atEnd()) {
+        unsigned char op;
+        reader.readByte(op);
+        if (!inFrame && op != OP_FRAME) {
+            return false;
+        }
+        switch (op) {
+          case OP_FRAME: {
+            int width, height;
+            if (inFrame || !reader.readInt(width) || !reader.readInt(height) ||
+                width < 0 || height < 0 ||
+                width > kMaxFrameSide || height > kMaxFrameSide) {
+                return false;
+            }
+            if (width != mCanvas->width() || height != mCanvas->height()) {
+                mCanvas->resize(width, height);
+            }
+            inFrame = true;
+            break;
+          }
+          case OP_SCROLL: {
+            Rect scrollRect;
+            int dx, dy;
+            if (!reader.readRect(scrollRect) ||
+                !reader.readInt(dx) || !reader.readInt(dy) ||
+                !fitsIn(scrollRect, mCanvas->width(), mCanvas->height()) ||
+                dx < -mCanvas->width() || dx > mCanvas->width() ||
+                dy < -mCanvas->height() || dy > mCanvas->height()) {
+                return false;
+            }
+            mCanvas->scroll(dx, dy, scrollRect);
+            break;
+          }
+          case OP_RECT: {
+            Rect rect;
+            unsigned char codec;
+            int length;
+            const unsigned char *payload;
+            if (!reader.readRect(rect) || !reader.readByte(codec) ||
+                !reader.readInt(length) || length < 0 ||
+                !reader.readBytes((size_t)length, payload) ||
+                !fitsIn(rect, mCanvas->width(), mCanvas->height())) {
+                return false;
+            }
+            const size_t count = (size_t)rect.width() * rect.height();
+            if (codec == CODEC_RAW) {
+                if ((size_t)length != count * 4) {
+                    return false;
+                }
+                mCanvas->blit(payload, rect, 1, &rect);
+            } else if (codec == CODEC_RLE) {
+                mPixels.resize(count * 4);
+                if (!rleDecode(payload, length, &mPixels[0], count)) {
+                    return false;
+                }
+                mCanvas->blit(&mPixels[0], rect, 1, &rect);
+            } else {
+                return false;
+            }
+            break;
+          }
+          case OP_END:
+            inFrame = false;
+            break;
+          default:
+            return false;
+        }
+    }
+    return !inFrame;
+}
+
+}
@@ -0,0 +1,233 @@
+/*  Berkelium Implementation
+ *  DirtyRegion.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DirtyRegion.hpp"
+
+namespace Berkelium {
+
+static inline long long rectArea(const Rect &r) {
+    return r.isEmpty() ? 0 : (long long)r.width() * r.height();
+}
+
+static inline Rect makeRect(int left, int top, int width, int height) {
+    Rect ret;
+    ret.mLeft = left;
+    ret.mTop = top;
+    ret.mWidth = width;
+    ret.mHeight = height;
+    return ret;
+}
+
+DirtyRegion::DirtyRegion(size_t maxRects) {
+    mAllocationCount = 0;
+    setMergePolicy(maxRects, -1);
+}
+
+void DirtyRegion::setMergePolicy(size_t maxRects, long long maxMergeWaste) {
+    mMaxRects = maxRects ? maxRects : 1;
+    mMaxMergeWaste = maxMergeWaste;
+    // An unlimited region still starts out with room for a typical paint.
+    mReserveRects = (mMaxRects < kDefaultMaxRects ? mMaxRects
+                                                  : kDefaultMaxRects) + 1;
+    mRects.reserve(mReserveRects);
+    mPieces.reserve(4 * mReserveRects);
+    mSplitPieces.reserve(4 * mReserveRects);
+    mCapacity = capacity();
+    while (mRects.size() > mMaxRects) {
+        mergeCheapestPair();
+    }
+    mergeWasteful();
+}
+
+size_t DirtyRegion::capacity() const {
+    return mRects.capacity() + mPieces.capacity() + mSplitPieces.capacity();
+}
+
+void DirtyRegion::noteAllocations() {
+    // Vectors only reallocate when they grow, so a change in total capacity
+    // means the heap was touched.
+    size_t current = capacity();
+    if (current != mCapacity) {
+        ++mAllocationCount;
+        mCapacity = current;
+    }
+}
+
+// Writes the parts of |a| not covered by |b| to |out| as up to four
+// non-overlapping bands and returns how many were written.
+static size_t subtractRect(const Rect &a, const Rect &b, Rect out[4]) {
+    const Rect overlap = a.intersect(b);
+    if (overlap.isEmpty()) {
+        out[0] = a;
+        return 1;
+    }
+    size_t count = 0;
+    if (overlap.top() > a.top()) {
+        out[count++] = makeRect(a.left(), a.top(),
+                                a.width(), overlap.top() - a.top());
+    }
+    if (overlap.bottom() < a.bottom()) {
+        out[count++] = makeRect(a.left(), overlap.bottom(),
+                                a.width(), a.bottom() - overlap.bottom());
+    }
+    if (overlap.left() > a.left()) {
+        out[count++] = makeRect(a.left(), overlap.top(),
+                                overlap.left() - a.left(), overlap.height());
+    }
+    if (overlap.right() < a.right()) {
+        out[count++] = makeRect(overlap.right(), overlap.top(),
+                                a.right() - overlap.right(), overlap.height());
+    }
+    return count;
+}
+
+void DirtyRegion::add(const Rect &rect) {
+    if (rect.isEmpty()) {
+        return;
+    }
+    for (size_t i = 0; i < mRects.size(); ++i) {
+        if (mRects[i].contains(rect)) {
+            return;
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < mRects.size(); ++i) {
+        if (!rect.contains(mRects[i])) {
+            mRects[kept++] = mRects[i];
+        }
+    }
+    mRects.resize(kept);
+
+    // Keep the list disjoint so no pixel is reported twice: cut the new rect
+    // around every rect it partially overlaps.
+    mPieces.clear();
+    mPieces.push_back(rect);
+    for (size_t i = 0; i < kept && !mPieces.empty(); ++i) {
+        mSplitPieces.clear();
+        for (size_t p = 0; p < mPieces.size(); ++p) {
+            Rect split[4];
+            size_t numSplit = subtractRect(mPieces[p], mRects[i], split);
+            mSplitPieces.insert(mSplitPieces.end(), split, split + numSplit);
+        }
+        mPieces.swap(mSplitPieces);
+    }
+    mRects.insert(mRects.end(), mPieces.begin(), mPieces.end());
+    while (mRects.size() > mMaxRects) {
+        mergeCheapestPair();
+    }
+    mergeWasteful();
+    noteAllocations();
+}
+
+void DirtyRegion::add(size_t numRects, const Rect *rects) {
+    for (size_t i = 0; i < numRects; ++i) {
+        add(rects[i]);
+    }
+}
+
+Rect DirtyRegion::bounds() const {
+    Rect ret = Rect();
+    for (size_t i = 0; i < mRects.size(); ++i) {
+        ret = ret.unite(mRects[i]);
+    }
+    return ret;
+}
+
+void DirtyRegion::drain(std::vector<Rect> &out) {
+    out.clear();
+    out.swap(mRects);
+    if (mRects.capacity() < mReserveRects) {
+        mRects.reserve(mReserveRects);
+        ++mAllocationCount;
+    }
+    // Swapping in the caller's storage is not an allocation.
+    mCapacity = capacity();
+}
+
+long long DirtyRegion::findCheapestPair(size_t &bestA, size_t &bestB) const {
+    long long bestCost = -1;
+    for (size_t a = 0; a < mRects.size(); ++a) {
+        for (size_t b = a + 1; b < mRects.size(); ++b) {
+            long long cost = rectArea(mRects[a].unite(mRects[b])) -
+                rectArea(mRects[a]) - rectArea(mRects[b]);
+            if (bestCost < 0 || cost < bestCost) {
+                bestCost = cost;
+                bestA = a;
+                bestB = b;
+            }
+        }
+    }
+    return bestCost;
+}
+
+void DirtyRegion::mergeCheapestPair() {
+    size_t bestA = 0, bestB = 1;
+    findCheapestPair(bestA, bestB);
+    mergePair(bestA, bestB);
+}
+
+void DirtyRegion::mergeWasteful() {
+    if (mMaxMergeWaste < 0) {
+        return;
+    }
+    while (mRects.size() > 1) {
+        size_t bestA = 0, bestB = 1;
+        if (findCheapestPair(bestA, bestB) > mMaxMergeWaste) {
+            break;
+        }
+        mergePair(bestA, bestB);
+    }
+}
+
+void DirtyRegion::mergePair(size_t a, size_t b) {
+    Rect merged = mRects[a].unite(mRects[b]);
+    mRects.erase(mRects.begin() + b);
+    mRects.erase(mRects.begin() + a);
+    // The bounding box may now overlap other rects; absorb them until the
+    // list is disjoint again. Each pass shrinks the list, so this ends.
+    bool grew = true;
+    while (grew) {
+        grew = false;
+        for (size_t i = 0; i < mRects.size(); ) {
+            if (merged.intersect(mRects[i]).isEmpty()) {
+                ++i;
+                continue;
+            }
+            merged = merged.unite(mRects[i]);
+            mRects.erase(mRects.begin() + i);
+            grew = true;
+        }
+    }
+    mRects.push_back(merged);
+}
+
+}
@@ -0,0 +1,110 @@
+/*  Berkelium Implementation
+ *  DirtyRegion.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_DIRTYREGION_HPP_
+#define _BERKELIUM_DIRTYREGION_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+#include <vector>
+
+namespace Berkelium {
+
+// Accumulates damage as a short list of non-overlapping rects. Rects covered
+// by another rect are dropped, partial overlaps are cut away, and once the
+// list grows past maxRects the pair whose bounding box adds the fewest extra
+// pixels is merged. A merge policy can additionally merge any pair whose
+// bounding box wastes no more than a given number of pixels.
+class DirtyRegion {
+public:
+    static const size_t kDefaultMaxRects = 16;
+    static const size_t kUnlimitedRects = (size_t)-1;
+
+    explicit DirtyRegion(size_t maxRects = kDefaultMaxRects);
+
+    // Changes how rects are merged. Up to maxRects rects are kept, and pairs
+    // are merged whenever their bounding box covers at most maxMergeWaste
+    // pixels that neither rect covered. A negative maxMergeWaste only merges
+    // to stay under maxRects.
+    void setMergePolicy(size_t maxRects, long long maxMergeWaste);
+
+    void add(const Rect &rect);
+    void add(size_t numRects, const Rect *rects);
+
+    void clear() {
+        mRects.clear();
+    }
+    bool empty() const {
+        return mRects.empty();
+    }
+    size_t size() const {
+        return mRects.size();
+    }
+    const Rect *rects() const {
+        return mRects.empty() ? NULL : &mRects[0];
+    }
+    Rect bounds() const;
+
+    // Replaces the contents of |out| with the accumulated rects and clears
+    // the region. Swaps storage, so passing the same vector every frame does
+    // not allocate.
+    void drain(std::vector<Rect> &out);
+
+    // Number of times add() or drain() had to grow internal storage.
+    size_t allocationCount() const {
+        return mAllocationCount;
+    }
+
+private:
+    long long findCheapestPair(size_t &bestA, size_t &bestB) const;
+    void mergeCheapestPair();
+    void mergeWasteful();
+    // Merges mRects[a] and mRects[b], where a < b.
+    void mergePair(size_t a, size_t b);
+    size_t capacity() const;
+    void noteAllocations();
+
+    std::vector<Rect> mRects;
+    // Scratch for splitting an added rect, kept to avoid reallocating.
+    std::vector<Rect> mPieces;
+    std::vector<Rect> mSplitPieces;
+    size_t mCapacity;
+    size_t mAllocationCount;
+    size_t mMaxRects;
+    long long mMaxMergeWaste;
+    // Initial capacity of mRects, restored after drain() swaps it away.
+    size_t mReserveRects;
+};
+
+}
+
+#endif
@@ -0,0 +1,245 @@
+/*  Berkelium Implementation
+ *  FrameCaptureImpl.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Window.hpp"
+#include "FrameCaptureImpl.hpp"
+#include "PixelConvert.hpp"
+
+#include "base/file_util.h"
+#include "base/task.h"
+#include "base/thread.h"
+#include "gfx/codec/png_codec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace Berkelium {
+
+FrameCapture *FrameCapture::create(CaptureFormat format, int numBuffers,
+                                   CaptureDropPolicy policy) {
+    return new FrameCaptureImpl(format, numBuffers, policy);
+}
+
+FrameCaptureImpl::FrameCaptureImpl(CaptureFormat format, int numBuffers,
+                                   CaptureDropPolicy policy)
+    : mFormat(format), mPolicy(policy), mThread(NULL),
+      mSlotFreed(&mLock), mWritten(0), mDropped(0), mErrors(0) {
+    mSlots.resize(numBuffers > 0 ? numBuffers : 1);
+    for (size_t i = 0; i < mSlots.size(); ++i) {
+        mSlots[i].state = SLOT_FREE;
+        mSlots[i].width = 0;
+        mSlots[i].height = 0;
+    }
+    base::Thread *thread = new base::Thread("BerkeliumCapture");
+    if (thread->Start()) {
+        mThread = thread;
+    } else {
+        // Frames are written synchronously instead.
+        delete thread;
+    }
+}
+
+FrameCaptureImpl::~FrameCaptureImpl() {
+    flush();
+    delete mThread;
+}
+
+bool FrameCaptureImpl::capture(Window *win, FileString path) {
+    Rect frameRect;
+    const unsigned char *frame = win->getFrame(frameRect);
+    if (!frame) {
+        return false;
+    }
+    return captureBuffer(frame, (size_t)frameRect.width() * 4,
+                         frameRect.width(), frameRect.height(), path);
+}
+
+bool FrameCaptureImpl::captureBuffer(const unsigned char *bgra, size_t stride,
+                                     int width, int height, FileString path) {
+    if (!bgra || width <= 0 || height <= 0) {
+        return false;
+    }
+    int index;
+    {
+        AutoLock lock(mLock);
+        index = claimSlot();
+        if (index < 0) {
+            ++mDropped;
+            return false;
+        }
+    }
+    Slot &slot = mSlots[index];
+    slot.width = width;
+    slot.height = height;
+    slot.path = FilePath(path.get<FilePath::StringType>());
+    size_t rowBytes = (size_t)width * 4;
+    slot.pixels.resize(rowBytes * height);
+    for (int y = 0; y < height; ++y) {
+        memcpy(&slot.pixels[y * rowBytes], bgra + y * stride, rowBytes);
+    }
+    {
+        AutoLock lock(mLock);
+        slot.state = SLOT_QUEUED;
+        mQueue.push_back(index);
+    }
+    if (mThread) {
+        mThread->message_loop()->PostTask(
+            FROM_HERE, NewRunnableFunction(&FrameCaptureImpl::writeNext, this));
+    } else {
+        writeNext(this);
+    }
+    return true;
+}
+
+int FrameCaptureImpl::claimSlot() {
+    while (true) {
+        for (size_t i = 0; i < mSlots.size(); ++i) {
+            if (mSlots[i].state == SLOT_FREE) {
+                mSlots[i].state = SLOT_FILLING;
+                return (int)i;
+            }
+        }
+        if (mPolicy == CAPTURE_DROP_OLDEST && !mQueue.empty()) {
+            // The task posted for this frame finds the queue one short and
+            // does nothing.
+            int oldest = mQueue.front();
+            mQueue.pop_front();
+            mSlots[oldest].state = SLOT_FILLING;
+            ++mDropped;
+            return oldest;
+        }
+        if (mPolicy != CAPTURE_BLOCK) {
+            return -1;
+        }
+        mSlotFreed.Wait();
+    }
+}
+
+void FrameCaptureImpl::writeNext(FrameCaptureImpl *capture) {
+    int index;
+    {
+        AutoLock lock(capture->mLock);
+        if (capture->mQueue.empty()) {
+            return;
+        }
+        index = capture->mQueue.front();
+        capture->mQueue.pop_front();
+        capture->mSlots[index].state = SLOT_WRITING;
+    }
+    bool written = capture->writeSlot(capture->mSlots[index]);
+    AutoLock lock(capture->mLock);
+    capture->mSlots[index].state = SLOT_FREE;
+    if (written) {
+        ++capture->mWritten;
+    } else {
+        ++capture->mErrors;
+    }
+    capture->mSlotFreed.Broadcast();
+}
+
+bool FrameCaptureImpl::writeSlot(const Slot &slot) {
+    const int width = slot.width;
+    const int height = slot.height;
+    const unsigned char *body = &slot.pixels[0];
+    size_t bodySize = slot.pixels.size();
+    switch (mFormat) {
+      case CAPTURE_FORMAT_PPM:
+        mConverted.resize((size_t)width * height * 3);
+        convertPixels(PIXEL_FORMAT_RGB24, body, (size_t)width * 4,
+                      &mConverted[0], (size_t)width * 3, width, height);
+        body = &mConverted[0];
+        bodySize = mConverted.size();
+        break;
+      case CAPTURE_FORMAT_PNG:
+        mConverted.resize((size_t)width * height * 4);
+        convertPixels(PIXEL_FORMAT_RGBA_UNPREMULTIPLIED, body,
+                      (size_t)width * 4, &mConverted[0], (size_t)width * 4,
+                      width, height);
+        mEncoded.clear();
+        if (!gfx::PNGCodec::Encode(&mConverted[0],
+                                   gfx::PNGCodec::FORMAT_RGBA,
+                                   width, height, width * 4,
+                                   false, &mEncoded)) {
+            return false;
+        }
+        body = &mEncoded[0];
+        bodySize = mEncoded.size();
+        break;
+      case CAPTURE_FORMAT_RAW:
+        break;
+    }
+
+    FILE *file = file_util::OpenFile(slot.path, "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = true;
+    if (mFormat == CAPTURE_FORMAT_PPM) {
+        ok = fprintf(file, "P6 %d %d 255\n", width, height) > 0;
+    }
+    ok = ok && fwrite(body, 1, bodySize, file) == bodySize;
+    return file_util::CloseFile(file) && ok;
+}
+
+void FrameCaptureImpl::flush() {
+    AutoLock lock(mLock);
+    while (true) {
+        bool busy = false;
+        for (size_t i = 0; i < mSlots.size(); ++i) {
+            if (mSlots[i].state != SLOT_FREE) {
+                busy = true;
+            }
+        }
+        if (!busy) {
+            break;
+        }
+        mSlotFreed.Wait();
+    }
+}
+
+unsigned long long FrameCaptureImpl::framesWritten() const {
+    AutoLock lock(mLock);
+    return mWritten;
+}
+
+unsigned long long FrameCaptureImpl::framesDropped() const {
+    AutoLock lock(mLock);
+    return mDropped;
+}
+
+unsigned long long FrameCaptureImpl::writeErrors() const {
+    AutoLock lock(mLock);
+    return mErrors;
+}
+
+}
@@ -0,0 +1,114 @@
+/*  Berkelium Implementation
+ *  FrameCaptureImpl.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAMECAPTUREIMPL_HPP_
+#define _BERKELIUM_FRAMECAPTUREIMPL_HPP_
+
+#include "berkelium/FrameCapture.hpp"
+#include "base/condition_variable.h"
+#include "base/file_path.h"
+#include "base/lock.h"
+#include <deque>
+#include <vector>
+
+namespace base {
+class Thread;
+}
+
+namespace Berkelium {
+
+// Ring of frame buffers drained by one writer thread. A buffer is claimed
+// and filled by the UI thread, queued, then encoded and written by the
+// writer, which hands it back. Only queued buffers may be taken back by
+// CAPTURE_DROP_OLDEST; the one being written is left alone.
+class FrameCaptureImpl : public FrameCapture {
+public:
+    FrameCaptureImpl(CaptureFormat format, int numBuffers,
+                     CaptureDropPolicy policy);
+    virtual ~FrameCaptureImpl();
+
+    virtual bool capture(Window *win, FileString path);
+    virtual bool captureBuffer(const unsigned char *bgra, size_t stride,
+                               int width, int height, FileString path);
+    virtual void flush();
+
+    virtual unsigned long long framesWritten() const;
+    virtual unsigned long long framesDropped() const;
+    virtual unsigned long long writeErrors() const;
+
+private:
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_FILLING,
+        SLOT_QUEUED,
+        SLOT_WRITING
+    };
+
+    struct Slot {
+        SlotState state;
+        int width;
+        int height;
+        FilePath path;
+        std::vector<unsigned char> pixels;
+    };
+
+    // Returns a buffer in SLOT_FILLING state, or -1 if the frame is to be
+    // dropped. Called with mLock held.
+    int claimSlot();
+    // Encodes and writes the oldest queued frame. Writer thread only.
+    static void writeNext(FrameCaptureImpl *capture);
+    bool writeSlot(const Slot &slot);
+
+    CaptureFormat mFormat;
+    CaptureDropPolicy mPolicy;
+    base::Thread *mThread;
+
+    // Guards every slot's state, mQueue and the counters. The pixels of a
+    // slot belong to whoever moved it out of SLOT_FREE or SLOT_QUEUED.
+    mutable Lock mLock;
+    // Signalled whenever a slot is freed.
+    ConditionVariable mSlotFreed;
+    std::vector<Slot> mSlots;
+    // Queued slots, oldest first.
+    std::deque<int> mQueue;
+    unsigned long long mWritten;
+    unsigned long long mDropped;
+    unsigned long long mErrors;
+
+    // Writer thread scratch space for format conversion and encoding.
+    std::vector<unsigned char> mConverted;
+    std::vector<unsigned char> mEncoded;
+};
+
+}
+
+#endif
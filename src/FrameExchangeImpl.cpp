@@ -0,0 +1,119 @@
+/*  Berkelium Implementation
+ *  FrameExchangeImpl.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "berkelium/Platform.hpp"
+#include "FrameExchangeImpl.hpp"
+
+#include <string.h>
+
+namespace Berkelium {
+
+FrameExchange *FrameExchange::create() {
+    return new FrameExchangeImpl;
+}
+
+FrameExchangeImpl::FrameExchangeImpl()
+    : mBack(0), mFront(1), mMiddle(2), mSequence(0) {
+    for (int i = 0; i < kNumSlots; ++i) {
+        mSlots[i].stride = 0;
+        mSlots[i].format = PIXEL_FORMAT_BGRA;
+        mSlots[i].rect = Rect();
+        mSlots[i].sequence = 0;
+    }
+}
+
+base::subtle::Atomic32 FrameExchangeImpl::swapMiddle(
+        base::subtle::Atomic32 value) {
+    // Everything written to the buffer handed over must be visible before
+    // the swap, and nothing may be read from the buffer received before it.
+    base::subtle::MemoryBarrier();
+    base::subtle::Atomic32 old =
+        base::subtle::NoBarrier_AtomicExchange(&mMiddle, value);
+    base::subtle::MemoryBarrier();
+    return old;
+}
+
+void FrameExchangeImpl::publish(const unsigned char *data, size_t stride,
+                                PixelFormat format, const Rect &rect,
+                                size_t numDirtyRects,
+                                const Rect *dirtyRects) {
+    if (!data || rect.isEmpty()) {
+        return;
+    }
+    Rect bounds = rect.translate(-rect.left(), -rect.top());
+    for (int i = 0; i < kNumSlots; ++i) {
+        for (size_t r = 0; r < numDirtyRects; ++r) {
+            mSlots[i].stale.add(dirtyRects[r].intersect(bounds));
+        }
+    }
+    Slot &slot = mSlots[mBack];
+    const size_t bytesPerPixel = pixelFormatBytesPerPixel(format);
+    if (slot.format != format || slot.rect.width() != rect.width() ||
+        slot.rect.height() != rect.height()) {
+        slot.stride = (size_t)rect.width() * bytesPerPixel;
+        slot.pixels.resize(slot.stride * rect.height());
+        slot.format = format;
+        slot.stale.clear();
+        slot.stale.add(bounds);
+    }
+    const Rect *stale = slot.stale.rects();
+    for (size_t r = 0; r < slot.stale.size(); ++r) {
+        const size_t rowBytes = (size_t)stale[r].width() * bytesPerPixel;
+        for (int y = stale[r].top(); y < stale[r].bottom(); ++y) {
+            memcpy(&slot.pixels[y * slot.stride +
+                                stale[r].left() * bytesPerPixel],
+                   data + y * stride + stale[r].left() * bytesPerPixel,
+                   rowBytes);
+        }
+    }
+    slot.stale.clear();
+    slot.rect = rect;
+    slot.sequence = ++mSequence;
+    mBack = swapMiddle(mBack | kFresh) & kIndexMask;
+}
+
+bool FrameExchangeImpl::acquire(ExchangedFrame &frame) {
+    bool fresh = false;
+    if (base::subtle::Acquire_Load(&mMiddle) & kFresh) {
+        mFront = swapMiddle(mFront) & kIndexMask;
+        fresh = true;
+    }
+    const Slot &slot = mSlots[mFront];
+    frame.mData = slot.sequence ? &slot.pixels[0] : NULL;
+    frame.mStride = slot.stride;
+    frame.mFormat = slot.format;
+    frame.mRect = slot.rect;
+    frame.mSequence = slot.sequence;
+    return fresh;
+}
+
+}
@@ -0,0 +1,86 @@
+/*  Berkelium Implementation
+ *  FrameExchangeImpl.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAMEEXCHANGEIMPL_HPP_
+#define _BERKELIUM_FRAMEEXCHANGEIMPL_HPP_
+
+#include "berkelium/FrameExchange.hpp"
+#include "DirtyRegion.hpp"
+#include "base/atomicops.h"
+#include <vector>
+
+namespace Berkelium {
+
+// Triple buffer. mBack belongs to the writer and mFront to the reader;
+// the third buffer's index lives in mMiddle together with kFresh, which
+// says it holds a frame the reader has not taken yet. Each side only ever
+// swaps its own buffer with the middle one, so no buffer is touched by
+// both threads at once.
+class FrameExchangeImpl : public FrameExchange {
+public:
+    FrameExchangeImpl();
+
+    virtual void publish(const unsigned char *data, size_t stride,
+                         PixelFormat format, const Rect &rect,
+                         size_t numDirtyRects, const Rect *dirtyRects);
+    virtual bool acquire(ExchangedFrame &frame);
+
+private:
+    static const int kNumSlots = 3;
+    static const base::subtle::Atomic32 kFresh = 4;
+    static const base::subtle::Atomic32 kIndexMask = 3;
+
+    struct Slot {
+        std::vector<unsigned char> pixels;
+        size_t stride;
+        PixelFormat format;
+        Rect rect;
+        unsigned long long sequence;
+        // Area not yet brought up to date with the latest publish. Only
+        // used by the writer, whoever holds the pixels.
+        DirtyRegion stale;
+    };
+
+    // Puts index in the middle with the given flags and returns the index
+    // and flags that were there, ordered against both sides' accesses.
+    base::subtle::Atomic32 swapMiddle(base::subtle::Atomic32 value);
+
+    Slot mSlots[kNumSlots];
+    int mBack;
+    int mFront;
+    volatile base::subtle::Atomic32 mMiddle;
+    unsigned long long mSequence;
+};
+
+}
+
+#endif
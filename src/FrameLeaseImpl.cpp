@@ -0,0 +1,218 @@
+/*  Berkelium Implementation
+ *  FrameLeaseImpl.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "berkelium/Platform.hpp"
+#include "FrameLeaseImpl.hpp"
+#include "MemoryRenderViewHost.hpp"
+
+#include "app/surface/transport_dib.h"
+#include "base/task.h"
+#include "chrome/browser/chrome_thread.h"
+
+#if defined(OS_MACOSX)
+#include <unistd.h>
+#endif
+
+namespace Berkelium {
+
+// Creates a second mapping of the same shared memory. The process host only
+// keeps a small cache of mapped DIBs and flushes it on a timer, so we cannot
+// rely on its mapping surviving for as long as the application holds a lease.
+// LeasedDIBCache keeps ours across paints instead.
+static TransportDIB *MapLeasedDIB(TransportDIB *dib) {
+#if defined(OS_WIN)
+    HANDLE section = NULL;
+    if (!DuplicateHandle(GetCurrentProcess(), dib->handle(),
+                         GetCurrentProcess(), &section,
+                         0, FALSE, DUPLICATE_SAME_ACCESS)) {
+        return NULL;
+    }
+    return TransportDIB::Map(section);
+#elif defined(OS_MACOSX)
+    int fd = dup(dib->handle().fd);
+    if (fd < 0) {
+        return NULL;
+    }
+    return TransportDIB::Map(base::FileDescriptor(fd, true));
+#else
+    return TransportDIB::Map(dib->handle());
+#endif
+}
+
+namespace {
+// Enough for the DIBs one renderer cycles through while painting.
+const size_t kMaxCachedDIBs = 4;
+
+// Ids are only guaranteed to be ordered, as the process host keys a map
+// with them.
+bool SameDIB(const TransportDIB::Id &a, const TransportDIB::Id &b) {
+    return !(a < b) && !(b < a);
+}
+}
+
+LeasedDIB *LeasedDIBCache::map(TransportDIB *dib,
+                               unsigned long &allocations) {
+    for (size_t i = 0; i < mEntries.size(); ++i) {
+        scoped_refptr<LeasedDIB> entry = mEntries[i];
+        if (SameDIB(entry->id(), dib->id()) && entry->size() >= dib->size()) {
+            mEntries.erase(mEntries.begin() + i);
+            mEntries.push_back(entry);
+            return entry;
+        }
+    }
+    TransportDIB *mapping = MapLeasedDIB(dib);
+    if (!mapping) {
+        return NULL;
+    }
+    if (!mapping->memory()) {
+        delete mapping;
+        return NULL;
+    }
+    ++allocations;
+    if (mEntries.size() >= kMaxCachedDIBs) {
+        // Leases still using it keep the mapping alive.
+        mEntries.erase(mEntries.begin());
+    }
+    mEntries.push_back(new LeasedDIB(dib->id(), mapping));
+    return mEntries.back();
+}
+
+FrameLeasePool::~FrameLeasePool() {
+    for (size_t i = 0; i < mFree.size(); ++i) {
+        delete mFree[i];
+    }
+}
+
+FrameLeaseImpl *FrameLeasePool::acquire(
+    PaintAckToken *token,
+    TransportDIB *dib,
+    const gfx::Rect &bitmap_rect,
+    const std::vector<gfx::Rect> &copy_rects,
+    int dx, int dy,
+    const gfx::Rect &scroll_rect,
+    unsigned long &allocations)
+{
+    LeasedDIB *mapping = mDIBs.map(dib, allocations);
+    if (!mapping) {
+        return NULL;
+    }
+    FrameLeaseImpl *lease;
+    if (mFree.empty()) {
+        lease = new FrameLeaseImpl;
+        ++allocations;
+    } else {
+        lease = mFree.back();
+        mFree.pop_back();
+    }
+    lease->mRefCount = 1;
+    lease->mToken = token;
+    lease->mDIB = mapping;
+    lease->mBufferRect.setFromRect(bitmap_rect);
+    if (copy_rects.size() > lease->mCopyRects.capacity()) {
+        ++allocations;
+    }
+    lease->mCopyRects.resize(copy_rects.size());
+    for (size_t i = 0; i < copy_rects.size(); ++i) {
+        lease->mCopyRects[i].setFromRect(copy_rects[i]);
+    }
+    lease->mDX = dx;
+    lease->mDY = dy;
+    lease->mScrollRect.setFromRect(scroll_rect);
+    return lease;
+}
+
+void FrameLeasePool::recycle(FrameLeaseImpl *lease,
+                             unsigned long &allocations) {
+    // Let an evicted mapping go now rather than at the next paint.
+    lease->mDIB = NULL;
+    if (mFree.size() == mFree.capacity()) {
+        ++allocations;
+    }
+    mFree.push_back(lease);
+}
+
+FrameLeaseImpl::FrameLeaseImpl()
+    : mRefCount(0), mDX(0), mDY(0) {
+}
+
+FrameLeaseImpl::~FrameLeaseImpl() {
+}
+
+void FrameLeaseImpl::addRef() {
+    base::AtomicRefCountInc(&mRefCount);
+}
+
+void FrameLeaseImpl::release() {
+    if (base::AtomicRefCountDec(&mRefCount)) {
+        return;
+    }
+    if (ChromeThread::CurrentlyOn(ChromeThread::UI)) {
+        finish(this);
+    } else {
+        ChromeThread::PostTask(
+            ChromeThread::UI, FROM_HERE,
+            NewRunnableFunction(&FrameLeaseImpl::finish, this));
+    }
+}
+
+void FrameLeaseImpl::finish(FrameLeaseImpl *lease) {
+    MemoryRenderHostBase *host = lease->mToken->host();
+    if (host) {
+        host->Memory_OnLeaseReleased(lease);
+    } else {
+        delete lease;
+    }
+}
+
+const unsigned char *FrameLeaseImpl::getBuffer() const {
+    return mDIB->memory();
+}
+const Rect &FrameLeaseImpl::getBufferRect() const {
+    return mBufferRect;
+}
+size_t FrameLeaseImpl::getNumCopyRects() const {
+    return mCopyRects.size();
+}
+const Rect *FrameLeaseImpl::getCopyRects() const {
+    return mCopyRects.empty() ? NULL : &mCopyRects[0];
+}
+int FrameLeaseImpl::getScrollX() const {
+    return mDX;
+}
+int FrameLeaseImpl::getScrollY() const {
+    return mDY;
+}
+const Rect &FrameLeaseImpl::getScrollRect() const {
+    return mScrollRect;
+}
+
+}
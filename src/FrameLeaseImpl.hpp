@@ -0,0 +1,174 @@
+/*  Berkelium Implementation
+ *  FrameLeaseImpl.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_FRAMELEASEIMPL_HPP_
+#define _BERKELIUM_FRAMELEASEIMPL_HPP_
+
+#include "berkelium/FrameLease.hpp"
+#include "app/surface/transport_dib.h"
+#include "base/atomic_ref_count.h"
+#include "base/ref_counted.h"
+#include "gfx/rect.h"
+#include <vector>
+
+namespace Berkelium {
+
+class MemoryRenderHostBase;
+
+// Shared between a render host and every lease it hands out, so that a lease
+// which outlives its host does not try to acknowledge through a dead pointer.
+// Only dereferenced on the UI thread.
+class PaintAckToken : public base::RefCountedThreadSafe<PaintAckToken> {
+public:
+    explicit PaintAckToken(MemoryRenderHostBase *host) : mHost(host) {}
+
+    MemoryRenderHostBase *host() const {
+        return mHost;
+    }
+    void detach() {
+        mHost = NULL;
+    }
+
+private:
+    friend class base::RefCountedThreadSafe<PaintAckToken>;
+    ~PaintAckToken() {}
+
+    MemoryRenderHostBase *mHost;
+};
+
+// A private mapping of a renderer's DIB, shared by the leases painted from
+// it. It stays valid even if the process host evicts the DIB from its own
+// cache, for as long as a lease or a LeasedDIBCache holds it.
+class LeasedDIB : public base::RefCountedThreadSafe<LeasedDIB> {
+public:
+    LeasedDIB(TransportDIB::Id id, TransportDIB *mapping)
+        : mId(id), mMapping(mapping) {}
+
+    TransportDIB::Id id() const {
+        return mId;
+    }
+    size_t size() const {
+        return mMapping->size();
+    }
+    const unsigned char *memory() const {
+        return static_cast<const unsigned char *>(mMapping->memory());
+    }
+
+private:
+    friend class base::RefCountedThreadSafe<LeasedDIB>;
+    ~LeasedDIB() {
+        delete mMapping;
+    }
+
+    TransportDIB::Id mId;
+    TransportDIB *mMapping;
+};
+
+// The DIBs a render host most recently leased out, so that each paint does
+// not map its DIB again. The renderer only cycles through a few of them.
+// UI thread only.
+class LeasedDIBCache {
+public:
+    // Returns the mapping of |dib|, creating it if needed, or NULL on
+    // failure. |allocations| is incremented if a mapping was created.
+    LeasedDIB *map(TransportDIB *dib, unsigned long &allocations);
+
+private:
+    // Least recently used first.
+    std::vector<scoped_refptr<LeasedDIB> > mEntries;
+};
+
+class FrameLeaseImpl;
+
+// The leases of one render host, with the DIB mappings behind them. Leases
+// whose last reference is gone come back here to be reused for later
+// paints, copy rect storage included. UI thread only.
+class FrameLeasePool {
+public:
+    FrameLeasePool() {}
+    ~FrameLeasePool();
+
+    // Returns a lease on |dib| with one reference, or NULL if the DIB could
+    // not be mapped; the caller should then fall back to a synchronous
+    // paint. |allocations| is incremented for each heap allocation or
+    // mapping this needed.
+    FrameLeaseImpl *acquire(PaintAckToken *token,
+                            TransportDIB *dib,
+                            const gfx::Rect &bitmap_rect,
+                            const std::vector<gfx::Rect> &copy_rects,
+                            int dx, int dy,
+                            const gfx::Rect &scroll_rect,
+                            unsigned long &allocations);
+    // Takes back a lease whose last reference is gone.
+    void recycle(FrameLeaseImpl *lease, unsigned long &allocations);
+
+private:
+    LeasedDIBCache mDIBs;
+    std::vector<FrameLeaseImpl*> mFree;
+};
+
+class FrameLeaseImpl : public FrameLease {
+public:
+    virtual void addRef();
+    virtual void release();
+
+    virtual const unsigned char *getBuffer() const;
+    virtual const Rect &getBufferRect() const;
+    virtual size_t getNumCopyRects() const;
+    virtual const Rect *getCopyRects() const;
+    virtual int getScrollX() const;
+    virtual int getScrollY() const;
+    virtual const Rect &getScrollRect() const;
+
+private:
+    friend class FrameLeasePool;
+
+    FrameLeaseImpl();
+    ~FrameLeaseImpl();
+
+    // Runs on the UI thread once the last reference is gone.
+    static void finish(FrameLeaseImpl *lease);
+
+    base::AtomicRefCount mRefCount;
+    scoped_refptr<PaintAckToken> mToken;
+    scoped_refptr<LeasedDIB> mDIB;
+
+    Rect mBufferRect;
+    std::vector<Rect> mCopyRects;
+    int mDX;
+    int mDY;
+    Rect mScrollRect;
+};
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*  Berkelium Implementation
+ *  InputLatency.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "InputLatency.hpp"
+
+namespace Berkelium {
+
+namespace {
+
+// Events the renderer never acknowledges, e.g. because it crashed, are
+// dropped after this long rather than skewing every later sample.
+const long long kStaleMicroseconds = 10 * 1000 * 1000;
+// Upper bound on tracked events, for the same reason.
+const size_t kMaxUnhandled = 256;
+
+void addSince(LatencyHistogram &histogram, long long since, long long now) {
+    histogram.addSample(now > since ? (unsigned long long)(now - since) : 0);
+}
+
+}
+
+InputLatencyTracker::InputLatencyTracker() {
+}
+
+void InputLatencyTracker::inputSent(InputKind kind, long long now) {
+    while (!mUnhandled.empty() &&
+           (mUnhandled.size() >= kMaxUnhandled ||
+            now - mUnhandled.front().mSent > kStaleMicroseconds)) {
+        mUnhandled.pop_front();
+    }
+    // The browser holds back a move or wheel event while one of the same
+    // kind is at the renderer, and replaces the held one with each newer
+    // one. Once both are queued, this event is absorbed by the held one,
+    // which keeps its earlier time; otherwise it gets an ACK of its own.
+    if (kind != INPUT_DISCRETE) {
+        size_t queued = 0;
+        for (std::deque<Probe>::const_iterator iter = mUnhandled.begin();
+             iter != mUnhandled.end(); ++iter) {
+            if (iter->mKind == kind) {
+                ++queued;
+            }
+        }
+        if (queued >= 2) {
+            return;
+        }
+    }
+    Probe probe;
+    probe.mKind = kind;
+    probe.mSent = now;
+    mUnhandled.push_back(probe);
+}
+
+void InputLatencyTracker::inputHandled(long long now, LatencyStats &stats) {
+    if (mUnhandled.empty()) {
+        return;
+    }
+    const long long sent = mUnhandled.front().mSent;
+    mUnhandled.pop_front();
+    addSince(stats.mInputToHandled, sent, now);
+    mHandled.push_back(sent);
+}
+
+void InputLatencyTracker::paintReceived(long long now, LatencyStats &stats,
+                                        bool keepUnpresented) {
+    if (!keepUnpresented || mPainted.size() >= kMaxUnhandled) {
+        mPainted.clear();
+    }
+    for (size_t i = 0; i < mHandled.size(); ++i) {
+        addSince(stats.mInputToPaint, mHandled[i], now);
+    }
+    mPainted.insert(mPainted.end(), mHandled.begin(), mHandled.end());
+    mHandled.clear();
+}
+
+void InputLatencyTracker::paintPresented(long long now, LatencyStats &stats) {
+    for (size_t i = 0; i < mPainted.size(); ++i) {
+        addSince(stats.mInputToPresent, mPainted[i], now);
+    }
+    mPainted.clear();
+}
+
+}
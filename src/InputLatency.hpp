@@ -0,0 +1,83 @@
+/*  Berkelium Implementation
+ *  InputLatency.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_INPUTLATENCY_HPP_
+#define _BERKELIUM_INPUTLATENCY_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/LatencyStats.hpp"
+#include <deque>
+#include <vector>
+
+namespace Berkelium {
+
+// Follows the input events sent to one render widget through to the paint
+// that shows them. Events are acknowledged by the renderer in the order
+// they were sent, so each acknowledgement completes the oldest event; the
+// first paint after that completes every acknowledged event. Times are
+// monotonic microseconds.
+class InputLatencyTracker {
+public:
+    enum InputKind {
+        INPUT_DISCRETE,
+        INPUT_MOUSE_MOVE,
+        INPUT_MOUSE_WHEEL
+    };
+
+    InputLatencyTracker();
+
+    void inputSent(InputKind kind, long long now);
+    void inputHandled(long long now, LatencyStats &stats);
+    // Events of an earlier paint that was never presented are dropped,
+    // unless |keepUnpresented| is set because paints are only presented
+    // when the application asks for a frame.
+    void paintReceived(long long now, LatencyStats &stats,
+                       bool keepUnpresented);
+    void paintPresented(long long now, LatencyStats &stats);
+
+private:
+    struct Probe {
+        InputKind mKind;
+        long long mSent;
+    };
+
+    // Sent but not acknowledged. The front event is at the renderer.
+    std::deque<Probe> mUnhandled;
+    // Send times of events acknowledged since the last paint.
+    std::vector<long long> mHandled;
+    // Send times of events whose paint is waiting to be presented.
+    std::vector<long long> mPainted;
+};
+
+}
+
+#endif
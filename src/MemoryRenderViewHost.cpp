@@ -35,8 +35,11 @@
 #include "berkelium/Window.hpp"
 #include "RenderWidget.hpp"
 #include "MemoryRenderViewHost.hpp"
+#include "PaintWorkerPool.hpp"
+#include "Root.hpp"
 #include <stdio.h>
 
+#include "base/message_loop.h"
 #include "chrome/browser/renderer_host/render_widget_host_view.h"
 #include "chrome/browser/renderer_host/render_process_host.h"
 #include "chrome/common/notification_service.h"
@@ -61,6 +64,10 @@ MemoryRenderViewHost::~MemoryRenderViewHost() {
 }
 
 void MemoryRenderViewHost::OnMessageReceived(const IPC::Message& msg) {
+  if (msg.type() == ViewHostMsg_HandleInputEvent_ACK::ID) {
+    // Only observed; RenderWidgetHost still handles the ACK below.
+    Memory_OnInputEventAck();
+  }
   bool msg_is_ok = true;
   IPC_BEGIN_MESSAGE_MAP_EX(MemoryRenderViewHost, msg, msg_is_ok)
     IPC_MESSAGE_HANDLER(ViewHostMsg_UpdateRect, Memory_OnMsgUpdateRect)
@@ -102,6 +109,9 @@ MemoryRenderWidgetHost::~MemoryRenderWidgetHost() {
 }
 
 void MemoryRenderWidgetHost::OnMessageReceived(const IPC::Message& msg) {
+  if (msg.type() == ViewHostMsg_HandleInputEvent_ACK::ID) {
+    Memory_OnInputEventAck();
+  }
   bool msg_is_ok = true;
   IPC_BEGIN_MESSAGE_MAP_EX(MemoryRenderWidgetHost, msg, msg_is_ok)
     IPC_MESSAGE_HANDLER(ViewHostMsg_UpdateRect, Memory_OnMsgUpdateRect)
@@ -127,8 +137,9 @@ void MemoryRenderWidgetHost::Memory_OnMsgUpdateRect(const ViewHostMsg_UpdateRect
 
 template <class T> void MemoryRenderHostImpl<T>::init() {
     mResizeAckPending=true;
+    mAckHeld=false;
     mWidget=NULL;
-    
+    mAckToken = new PaintAckToken(this);
 }
 template <class T> void MemoryRenderHostImpl<T>::Memory_WasResized() {
     if (this->mResizeAckPending || !this->process()->HasConnection() || !this->view() || !this->renderer_initialized_) {
@@ -160,6 +171,10 @@ template <class T> void MemoryRenderHostImpl<T>::Memory_OnMsgUpdateRect(
     const ViewHostMsg_UpdateRect_Params&params)
 {
   current_size_ = params.view_size;
+  RenderWidget *latencyWidget = static_cast<RenderWidget*>(this->view());
+  if (latencyWidget) {
+    latencyWidget->paintReceived();
+  }
 
     DCHECK(!params.bitmap_rect.IsEmpty());
     DCHECK(!params.view_size.IsEmpty());
@@ -184,11 +199,25 @@ template <class T> void MemoryRenderHostImpl<T>::Memory_OnMsgUpdateRect(
 
   const size_t size = params.bitmap_rect.height() *
                       params.bitmap_rect.width() * 4;
+  bool ack_deferred = false;
   TransportDIB* dib = this->process()->GetTransportDIB(params.bitmap);
   if (dib) {
     if (dib->size() < size) {
       DLOG(WARNING) << "Transport DIB too small for given rectangle";
       this->process()->ReceivedBadMessage(ViewHostMsg_UpdateRect__ID);
+    } else if (mWindow->usesLeasedFrames() &&
+               Memory_LeaseBackingStoreRect(dib, params)) {
+      // The ACK is sent from Memory_OnLeaseReleased once the application has
+      // let go of the renderer's buffer.
+      ack_deferred = true;
+      if (latencyWidget) {
+        latencyWidget->paintPresented();
+      }
+    } else if (!mWidget && mWindow->paintsOnWorker() &&
+               Memory_QueueBackingStoreRect(dib, params)) {
+      // A paint worker updates the canvas; the lease is released, and the
+      // ACK sent, once Root::update has delivered the paint.
+      ack_deferred = true;
     } else {
       // Paint the backing store. This will update it with the renderer-supplied
       // bits. The view will read out of the backing store later to actually
@@ -196,6 +225,11 @@ template <class T> void MemoryRenderHostImpl<T>::Memory_OnMsgUpdateRect(
       Memory_PaintBackingStoreRect(dib, params.bitmap_rect,
         params.copy_rects, params.view_size,
         params.dx, params.dy, params.scroll_rect);
+      // Canvas paints are presented by WindowImpl::deliverCanvasPaint, and
+      // only if the damage filter left something to deliver.
+      if (latencyWidget && (mWidget || !mWindow->paintsCanvas())) {
+        latencyWidget->paintPresented();
+      }
       // FIXME: Difference between scroll_rect + params.view_size and clip_rect
     }
   }
@@ -204,7 +238,9 @@ template <class T> void MemoryRenderHostImpl<T>::Memory_OnMsgUpdateRect(
   // This must be done AFTER we're done painting with the bitmap supplied by the
   // renderer. This ACK is a signal to the renderer that the backing store can
   // be re-used, so the bitmap may be invalid after this call.
-  this->process()->Send(new ViewMsg_UpdateRect_ACK(this->routing_id()));
+  if (!ack_deferred) {
+    Memory_AckUpdateRect();
+  }
 
   // Now paint the view. Watch out: it might be destroyed already.
   if (this->view()) {
@@ -227,6 +263,93 @@ template <class T> void MemoryRenderHostImpl<T>::Memory_OnMsgUpdateRect(
 
 }
 
+template <class T> void MemoryRenderHostImpl<T>::Memory_AckUpdateRect() {
+    if (!mWidget && mWindow->holdsPaintAck()) {
+        // Painting on demand: the renderer waits for the next request.
+        mAckHeld = true;
+        return;
+    }
+    // The renderer will not send another UpdateRect until it gets the ACK,
+    // and meanwhile folds new invalidations into the next one. Holding the
+    // ACK back therefore both paces the renderer and merges its damage.
+    base::TimeDelta interval = mWindow->getMinFrameInterval();
+    if (interval > base::TimeDelta() && !mLastAckTime.is_null()) {
+        base::TimeDelta wait =
+            mLastAckTime + interval - base::TimeTicks::Now();
+        if (wait > base::TimeDelta()) {
+            MessageLoop::current()->PostDelayedTask(
+                FROM_HERE,
+                mAckFactory.NewRunnableMethod(
+                    &MemoryRenderHostImpl<T>::Memory_SendUpdateRectAck),
+                static_cast<int>((wait.InMicroseconds() + 999) / 1000));
+            return;
+        }
+    }
+    Memory_SendUpdateRectAck();
+}
+
+template <class T> void MemoryRenderHostImpl<T>::Memory_SendUpdateRectAck() {
+    mLastAckTime = base::TimeTicks::Now();
+    this->process()->Send(new ViewMsg_UpdateRect_ACK(this->routing_id()));
+}
+
+template <class T> void MemoryRenderHostImpl<T>::Memory_OnInputEventAck() {
+    RenderWidget *widget = static_cast<RenderWidget*>(this->view());
+    if (widget) {
+        widget->inputHandled();
+    }
+}
+
+template <class T> void MemoryRenderHostImpl<T>::Memory_ReleaseHeldAck() {
+    if (mAckHeld) {
+        mAckHeld = false;
+        Memory_AckUpdateRect();
+    }
+}
+
+template <class T> void MemoryRenderHostImpl<T>::Memory_OnLeaseReleased(
+    FrameLeaseImpl *lease)
+{
+    mLeasePool.recycle(lease, mWindow->paintStats().mAllocationCount);
+    Memory_AckUpdateRect();
+}
+
+template <class T> bool MemoryRenderHostImpl<T>::Memory_LeaseBackingStoreRect(
+    TransportDIB* bitmap,
+    const ViewHostMsg_UpdateRect_Params&params)
+{
+    FrameLeaseImpl *lease = mLeasePool.acquire(
+        mAckToken, bitmap,
+        params.bitmap_rect, params.copy_rects,
+        params.dx, params.dy, params.scroll_rect,
+        mWindow->paintStats().mAllocationCount);
+    if (!lease) {
+        return false;
+    }
+    mWindow->onLeasedPaint(mWidget, lease);
+    // Drop our own reference. If the delegate did not keep one, this sends
+    // the ACK right away.
+    lease->release();
+    return true;
+}
+
+template <class T> bool MemoryRenderHostImpl<T>::Memory_QueueBackingStoreRect(
+    TransportDIB* bitmap,
+    const ViewHostMsg_UpdateRect_Params&params)
+{
+    FrameLeaseImpl *lease = mLeasePool.acquire(
+        mAckToken, bitmap,
+        params.bitmap_rect, params.copy_rects,
+        params.dx, params.dy, params.scroll_rect,
+        mWindow->paintStats().mAllocationCount);
+    if (!lease) {
+        return false;
+    }
+    Root::getSingleton().getPaintWorkers()->post(
+        mWindow, lease, params.view_size);
+    return true;
+}
+
 template <class T> void MemoryRenderHostImpl<T>::Memory_PaintBackingStoreRect(
     TransportDIB* bitmap,
     const gfx::Rect& bitmap_rect,
@@ -242,7 +365,7 @@ template <class T> void MemoryRenderHostImpl<T>::Memory_PaintBackingStoreRect(
     clipRect.setFromRect(clip_rect);
 
     size_t numCopyRects = copy_rects.size();
-    Rect * copyRects = new Rect [numCopyRects];
+    Rect *copyRects = mWindow->paintRectArena(numCopyRects);
 
     for (size_t i = 0; i < numCopyRects; ++i) {
         copyRects[i].setFromRect(copy_rects[i]);
@@ -256,7 +379,8 @@ template <class T> void MemoryRenderHostImpl<T>::Memory_PaintBackingStoreRect(
         copyRects,
         dx,
         dy,
-        clipRect);
+        clipRect,
+        view_size);
 
 }
 
@@ -35,6 +35,9 @@
 
 #include "chrome/browser/renderer_host/render_view_host.h"
 #include "chrome/browser/renderer_host/render_view_host_factory.h"
+#include "base/task.h"
+#include "base/time.h"
+#include "FrameLeaseImpl.hpp"
 
 class RenderWidgetHostView;
 namespace Berkelium {
@@ -42,6 +45,7 @@ class WindowImpl;
 class RenderWidget;
 
 class MemoryRenderHostBase {
+public:
     MemoryRenderHostBase() {}
     virtual ~MemoryRenderHostBase() {}
 
@@ -52,16 +56,22 @@ class MemoryRenderHostBase {
                                       const gfx::Size& view_size,
                                       int dx, int dy,
                                       const gfx::Rect& clip_rect)=0;
+    // The last reference to a FrameLease from this host has been released.
+    // The host takes |lease| back for later paints.
+    virtual void Memory_OnLeaseReleased(FrameLeaseImpl *lease)=0;
 
 };
 
-template <class RenderXHost> class MemoryRenderHostImpl: public RenderXHost {
+template <class RenderXHost> class MemoryRenderHostImpl:
+        public RenderXHost, public MemoryRenderHostBase {
     void init();
 protected:
-    template<class A, class B, class C, class D> MemoryRenderHostImpl(A a, B b, C c, D d):RenderXHost(a,b,c,d) {init();}
-    template<class A, class B, class C> MemoryRenderHostImpl(A a, B b, C c):RenderXHost(a,b,c) {init();}
-    template<class A, class B> MemoryRenderHostImpl(A a, B b):RenderXHost(a,b) {   init();}
-    ~MemoryRenderHostImpl() {}
+    template<class A, class B, class C, class D> MemoryRenderHostImpl(A a, B b, C c, D d):RenderXHost(a,b,c,d), mAckFactory(this) {init();}
+    template<class A, class B, class C> MemoryRenderHostImpl(A a, B b, C c):RenderXHost(a,b,c), mAckFactory(this) {init();}
+    template<class A, class B> MemoryRenderHostImpl(A a, B b):RenderXHost(a,b), mAckFactory(this) {   init();}
+    ~MemoryRenderHostImpl() {
+        mAckToken->detach();
+    }
 
 public:
     void Memory_WasResized();
@@ -72,12 +82,38 @@ public:
                                       const gfx::Size& view_size,
                                       int dx, int dy,
                                       const gfx::Rect& clip_rect);
+    virtual void Memory_OnLeaseReleased(FrameLeaseImpl *lease);
+    // Sends the ACK held back while the Window paints on demand.
+    void Memory_ReleaseHeldAck();
 protected:
+    // Sends the UpdateRect ACK now, or later if the Window's frame rate cap
+    // says the next frame is not due yet.
+    void Memory_AckUpdateRect();
+    void Memory_SendUpdateRectAck();
+    // Records input latency when the renderer acknowledges an input event.
+    void Memory_OnInputEventAck();
+    // Hands the DIB to the delegate as a FrameLease. Returns false if the
+    // lease could not be created and the ACK should be sent immediately.
+    bool Memory_LeaseBackingStoreRect(TransportDIB* bitmap,
+                                      const ViewHostMsg_UpdateRect_Params&params);
+    // Hands the DIB to the paint worker pool. Returns false if the lease
+    // could not be created and the paint should happen synchronously.
+    bool Memory_QueueBackingStoreRect(TransportDIB* bitmap,
+                                      const ViewHostMsg_UpdateRect_Params&params);
+
     WindowImpl *mWindow;
     RenderWidget *mWidget;
     gfx::Size current_size_;
     bool mResizeAckPending;
+    // An UpdateRect ACK is being held back, see WindowImpl::holdsPaintAck.
+    bool mAckHeld;
     gfx::Size mInFlightSize;
+    scoped_refptr<PaintAckToken> mAckToken;
+    // Leases and DIB mappings, reused from one paint to the next.
+    FrameLeasePool mLeasePool;
+    // When the last ACK went out, for pacing to the frame rate cap.
+    base::TimeTicks mLastAckTime;
+    ScopedRunnableMethodFactory<MemoryRenderHostImpl<RenderXHost> > mAckFactory;
 };
 
 class MemoryRenderWidgetHost : public MemoryRenderHostImpl<RenderWidgetHost> {
@@ -0,0 +1,107 @@
+/*  Berkelium Implementation
+ *  OutputSurface.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "OutputSurface.hpp"
+#include "Canvas.hpp"
+#include "PixelConvert.hpp"
+
+namespace Berkelium {
+
+OutputSurface::OutputSurface(PixelFormat format) {
+    mFormat = format;
+    mData = NULL;
+    mCapacity = 0;
+    mQuantum = 1;
+    mWidth = 0;
+    mHeight = 0;
+}
+
+OutputSurface::~OutputSurface() {
+    delete []mData;
+}
+
+Rect OutputSurface::rect() const {
+    Rect ret;
+    ret.mLeft = 0;
+    ret.mTop = 0;
+    ret.mWidth = mWidth;
+    ret.mHeight = mHeight;
+    return ret;
+}
+
+bool OutputSurface::update(const Canvas &canvas,
+                           size_t numRects, const Rect *rects) {
+    const Rect bounds = canvas.rect();
+    const size_t bytesPerPixel = pixelFormatBytesPerPixel(mFormat);
+    bool reallocated = false;
+    if (canvas.width() != mWidth || canvas.height() != mHeight) {
+        mWidth = canvas.width();
+        mHeight = canvas.height();
+        const size_t needed = stride() * mHeight;
+        if (needed > mCapacity) {
+            delete []mData;
+            const size_t quantizedWidth =
+                ((size_t)mWidth + mQuantum - 1) / mQuantum * mQuantum;
+            const size_t quantizedHeight =
+                ((size_t)mHeight + mQuantum - 1) / mQuantum * mQuantum;
+            mCapacity = quantizedWidth * bytesPerPixel * quantizedHeight;
+            mData = new unsigned char[mCapacity];
+            reallocated = true;
+        }
+        // Nothing in the buffer is valid for the new size yet.
+        numRects = 1;
+        rects = &bounds;
+    }
+    if (!data() || !canvas.data()) {
+        return reallocated;
+    }
+    for (size_t i = 0; i < numRects; ++i) {
+        Rect r = rects[i].intersect(bounds);
+        if (r.isEmpty()) {
+            continue;
+        }
+        convertPixels(mFormat,
+                      canvas.data() + r.top() * canvas.stride() +
+                          r.left() * Canvas::kBytesPerPixel,
+                      canvas.stride(),
+                      mData + r.top() * stride() + r.left() * bytesPerPixel,
+                      stride(),
+                      r.width(), r.height());
+    }
+    return reallocated;
+}
+
+void OutputSurface::setSizeQuantum(int quantum) {
+    mQuantum = quantum > 1 ? quantum : 1;
+}
+
+}
@@ -0,0 +1,91 @@
+/*  Berkelium Implementation
+ *  OutputSurface.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_OUTPUTSURFACE_HPP_
+#define _BERKELIUM_OUTPUTSURFACE_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/PixelFormat.hpp"
+#include "berkelium/Rect.hpp"
+
+namespace Berkelium {
+
+class Canvas;
+
+// A copy of a Canvas in another pixel format. Only the rects passed to
+// update() are converted, so the surface stays in sync with the canvas at
+// the cost of converting each paint's damage once.
+class OutputSurface {
+public:
+    explicit OutputSurface(PixelFormat format);
+    ~OutputSurface();
+
+    PixelFormat format() const {
+        return mFormat;
+    }
+    int width() const {
+        return mWidth;
+    }
+    int height() const {
+        return mHeight;
+    }
+    size_t stride() const {
+        return (size_t)mWidth * pixelFormatBytesPerPixel(mFormat);
+    }
+    Rect rect() const;
+    const unsigned char *data() const {
+        return mWidth && mHeight ? mData : NULL;
+    }
+
+    // Matches the size of |canvas| and converts the given rects from it,
+    // or the whole canvas if its size changed. Like the Canvas, memory is
+    // only ever grown. Returns true if a new buffer was allocated.
+    bool update(const Canvas &canvas, size_t numRects, const Rect *rects);
+
+    // See Canvas::setSizeQuantum.
+    void setSizeQuantum(int quantum);
+
+private:
+    OutputSurface(const OutputSurface&);
+    OutputSurface &operator=(const OutputSurface&);
+
+    PixelFormat mFormat;
+    unsigned char *mData;
+    size_t mCapacity;
+    int mQuantum;
+    int mWidth;
+    int mHeight;
+};
+
+}
+
+#endif
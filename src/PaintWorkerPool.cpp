@@ -0,0 +1,168 @@
+/*  Berkelium Implementation
+ *  PaintWorkerPool.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "berkelium/Platform.hpp"
+#include "PaintWorkerPool.hpp"
+#include "FrameLeaseImpl.hpp"
+#include "WindowImpl.hpp"
+
+#include "base/string_util.h"
+#include "base/task.h"
+#include "base/thread.h"
+
+namespace Berkelium {
+
+PaintWorkerPool::PaintWorkerPool(int numThreads)
+    : mIdle(&mLock), mOutstanding(0), mDelivering(NULL) {
+    for (int i = 0; i < numThreads; ++i) {
+        base::Thread *thread = new base::Thread(
+            StringPrintf("BerkeliumPaint%d", i).c_str());
+        if (!thread->Start()) {
+            delete thread;
+            break;
+        }
+        mThreads.push_back(thread);
+    }
+}
+
+PaintWorkerPool::~PaintWorkerPool() {
+    finishPending();
+    for (size_t i = 0; i < mThreads.size(); ++i) {
+        delete mThreads[i];
+    }
+    for (size_t i = 0; i < mFreeJobs.size(); ++i) {
+        delete mFreeJobs[i];
+    }
+}
+
+void PaintWorkerPool::post(WindowImpl *window, FrameLeaseImpl *lease,
+                           const gfx::Size &viewSize) {
+    PaintStats &stats = window->paintStats();
+    Job *job;
+    if (mFreeJobs.empty()) {
+        job = new Job;
+        ++stats.mAllocationCount;
+    } else {
+        job = mFreeJobs.back();
+        mFreeJobs.pop_back();
+    }
+    job->window = window;
+    job->lease = lease;
+    job->viewSize = viewSize;
+    job->changed = false;
+    job->stats = PaintStats();
+    if (mPosted.size() == mPosted.capacity()) {
+        ++stats.mAllocationCount;
+    }
+    mPosted.push_back(job);
+    // The message loop allocates the task below.
+    ++stats.mAllocationCount;
+    {
+        AutoLock lock(mLock);
+        ++mOutstanding;
+    }
+    size_t worker = (size_t)window->getId() % mThreads.size();
+    mThreads[worker]->message_loop()->PostTask(
+        FROM_HERE, NewRunnableFunction(&PaintWorkerPool::runJob, this, job));
+}
+
+void PaintWorkerPool::runJob(PaintWorkerPool *pool, Job *job) {
+    job->changed = job->window->paintOnWorker(job->lease, job->viewSize,
+                                              job->stats);
+    AutoLock lock(pool->mLock);
+    if (--pool->mOutstanding == 0) {
+        pool->mIdle.Broadcast();
+    }
+}
+
+void PaintWorkerPool::waitForWorkers() {
+    AutoLock lock(mLock);
+    while (mOutstanding) {
+        mIdle.Wait();
+    }
+}
+
+void PaintWorkerPool::finishPending() {
+    if (mPosted.empty()) {
+        return;
+    }
+    waitForWorkers();
+    // Delegates may post more paints or destroy windows, so detach the list
+    // before calling out.
+    std::vector<Job*> done;
+    done.swap(mPosted);
+    std::vector<Job*> *outerDelivering = mDelivering;
+    mDelivering = &done;
+    for (size_t i = 0; i < done.size(); ++i) {
+        Job *job = done[i];
+        if (job->window) {
+            job->window->paintStats().add(job->stats);
+        }
+        if (job->window) {
+            job->window->pagePaintApplied(job->changed);
+        }
+        // Dropping the lease ACKs the renderer.
+        job->lease->release();
+        if (mFreeJobs.size() == mFreeJobs.capacity() && job->window) {
+            ++job->window->paintStats().mAllocationCount;
+        }
+        job->lease = NULL;
+        job->window = NULL;
+        mFreeJobs.push_back(job);
+        done[i] = NULL;
+    }
+    mDelivering = outerDelivering;
+    // Hand the list's storage back for the next round of paints.
+    done.clear();
+    if (mPosted.empty()) {
+        mPosted.swap(done);
+    }
+}
+
+void PaintWorkerPool::forgetWindow(WindowImpl *window) {
+    waitForWorkers();
+    for (size_t i = 0; i < mPosted.size(); ++i) {
+        if (mPosted[i]->window == window) {
+            mPosted[i]->window = NULL;
+        }
+    }
+    if (mDelivering) {
+        for (size_t i = 0; i < mDelivering->size(); ++i) {
+            Job *job = (*mDelivering)[i];
+            if (job && job->window == window) {
+                job->window = NULL;
+            }
+        }
+    }
+}
+
+}
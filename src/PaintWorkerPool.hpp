@@ -0,0 +1,113 @@
+/*  Berkelium Implementation
+ *  PaintWorkerPool.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_PAINTWORKERPOOL_HPP_
+#define _BERKELIUM_PAINTWORKERPOOL_HPP_
+
+#include "berkelium/PaintStats.hpp"
+#include "base/condition_variable.h"
+#include "base/lock.h"
+#include "gfx/size.h"
+#include <vector>
+
+namespace base {
+class Thread;
+}
+
+namespace Berkelium {
+
+class FrameLeaseImpl;
+class WindowImpl;
+
+// Threads that apply paints to Window canvases off the UI thread. Each
+// Window is pinned to one worker so its paints stay in order, while
+// different Windows update in parallel. The UI thread only hands over a
+// lease on the renderer's DIB; finishPending() then waits for the workers
+// and, back on the UI thread, calls the delegates and releases the leases,
+// which ACKs the renderer.
+class PaintWorkerPool {
+public:
+    explicit PaintWorkerPool(int numThreads);
+    // Finishes any queued paints before stopping the threads.
+    ~PaintWorkerPool();
+
+    int size() const {
+        return (int)mThreads.size();
+    }
+
+    // Queues a canvas update from |lease| for |window|. Takes ownership of
+    // the caller's reference to |lease|. UI thread only.
+    void post(WindowImpl *window, FrameLeaseImpl *lease,
+              const gfx::Size &viewSize);
+
+    // Blocks until every queued paint is done, then adds up their
+    // PaintStats and notifies the delegates in the order the paints were
+    // posted. UI thread only.
+    void finishPending();
+
+    // Blocks until the workers are idle, so the UI thread can safely touch
+    // any canvas. UI thread only.
+    void waitForWorkers();
+
+    // Called as |window| is destroyed: waits for its queued paints and
+    // makes sure they are never delivered. UI thread only.
+    void forgetWindow(WindowImpl *window);
+
+private:
+    struct Job {
+        WindowImpl *window;
+        FrameLeaseImpl *lease;
+        gfx::Size viewSize;
+        bool changed;
+        // Counted by the worker, added to the Window's on the UI thread.
+        PaintStats stats;
+    };
+
+    static void runJob(PaintWorkerPool *pool, Job *job);
+
+    std::vector<base::Thread*> mThreads;
+
+    Lock mLock;
+    ConditionVariable mIdle;
+    // Guarded by mLock.
+    int mOutstanding;
+    // UI thread only, in posting order.
+    std::vector<Job*> mPosted;
+    // Delivered jobs kept for reuse. UI thread only.
+    std::vector<Job*> mFreeJobs;
+    // Jobs finishPending is currently delivering, or NULL.
+    std::vector<Job*> *mDelivering;
+};
+
+}
+
+#endif
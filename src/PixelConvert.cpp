@@ -0,0 +1,451 @@
+/*  Berkelium Implementation
+ *  PixelConvert.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PixelConvert.hpp"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#define BERKELIUM_PIXEL_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BERKELIUM_PIXEL_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define BERKELIUM_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Berkelium {
+
+namespace {
+
+typedef void (*RowConverter)(const unsigned char *src, unsigned char *dest,
+                             int width);
+
+// Fixed point 255/alpha, so unpremultiplying is a multiply and a shift.
+class UnpremultiplyTable {
+public:
+    UnpremultiplyTable() {
+        mScale[0] = 0;
+        for (unsigned int a = 1; a < 256; ++a) {
+            // Rounded up so that c * 255 / a rounds exactly for all c <= a.
+            mScale[a] = ((255u << 16) + a - 1) / a;
+        }
+    }
+    unsigned char apply(unsigned char c, unsigned char a) const {
+        unsigned int v = (c * mScale[a] + 0x8000) >> 16;
+        return v > 255 ? 255 : (unsigned char)v;
+    }
+private:
+    unsigned int mScale[256];
+};
+
+const UnpremultiplyTable sUnpremultiply;
+
+//////// Scalar kernels, also used for the tail of each SIMD row ////////
+
+void copyRow(const unsigned char *src, unsigned char *dest, int width) {
+    memcpy(dest, src, (size_t)width * 4);
+}
+
+void swapRedBlueRowScalar(const unsigned char *src, unsigned char *dest,
+                          int width) {
+    for (int x = 0; x < width; ++x) {
+        dest[0] = src[2];
+        dest[1] = src[1];
+        dest[2] = src[0];
+        dest[3] = src[3];
+        src += 4;
+        dest += 4;
+    }
+}
+
+template <bool swapRedBlue>
+void unpremultiplyRowScalar(const unsigned char *src, unsigned char *dest,
+                            int width) {
+    const int r = swapRedBlue ? 0 : 2;
+    const int b = swapRedBlue ? 2 : 0;
+    for (int x = 0; x < width; ++x) {
+        const unsigned char a = src[3];
+        if (a == 255) {
+            dest[r] = src[2];
+            dest[1] = src[1];
+            dest[b] = src[0];
+        } else {
+            dest[r] = sUnpremultiply.apply(src[2], a);
+            dest[1] = sUnpremultiply.apply(src[1], a);
+            dest[b] = sUnpremultiply.apply(src[0], a);
+        }
+        dest[3] = a;
+        src += 4;
+        dest += 4;
+    }
+}
+
+void rgb24RowScalar(const unsigned char *src, unsigned char *dest,
+                    int width) {
+    for (int x = 0; x < width; ++x) {
+        dest[0] = src[2];
+        dest[1] = src[1];
+        dest[2] = src[0];
+        src += 4;
+        dest += 3;
+    }
+}
+
+void rgb565RowScalar(const unsigned char *src, unsigned char *dest,
+                     int width) {
+    for (int x = 0; x < width; ++x) {
+        unsigned short v = (unsigned short)(
+            ((src[2] & 0xF8) << 8) | ((src[1] & 0xFC) << 3) | (src[0] >> 3));
+        memcpy(dest, &v, 2);
+        src += 4;
+        dest += 2;
+    }
+}
+
+//////// SSE2 / AVX2 ////////
+
+bool opaqueRowScalar(const unsigned char *src, int width) {
+    unsigned char alpha = 0xFF;
+    for (int x = 0; x < width; ++x) {
+        alpha &= src[x * 4 + 3];
+    }
+    return alpha == 0xFF;
+}
+
+#if BERKELIUM_PIXEL_SSE2
+
+// Swaps bytes 0 and 2 of every 32 bit pixel.
+inline __m128i swapRedBlue(__m128i px) {
+    const __m128i rb = _mm_set1_epi32(0x00FF00FF);
+    __m128i ag = _mm_andnot_si128(rb, px);
+    __m128i rbPx = _mm_and_si128(rb, px);
+    return _mm_or_si128(ag, _mm_or_si128(_mm_slli_epi32(rbPx, 16),
+                                         _mm_srli_epi32(rbPx, 16)));
+}
+
+// Packs each BGRA pixel into 565 in the low half of its 32 bit lane,
+// sign-extended so that _mm_packs_epi32 keeps all 16 bits.
+inline __m128i to565(__m128i px) {
+    __m128i v = _mm_or_si128(
+        _mm_and_si128(_mm_srli_epi32(px, 3), _mm_set1_epi32(0x001F)),
+        _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi32(px, 5), _mm_set1_epi32(0x07E0)),
+            _mm_and_si128(_mm_srli_epi32(px, 8), _mm_set1_epi32(0xF800))));
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+inline bool allOpaque(__m128i px) {
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    return _mm_movemask_epi8(
+        _mm_cmpeq_epi32(_mm_and_si128(px, alpha), alpha)) == 0xFFFF;
+}
+
+#if BERKELIUM_PIXEL_AVX2
+
+inline __m256i swapRedBlue(__m256i px) {
+    const __m256i rb = _mm256_set1_epi32(0x00FF00FF);
+    __m256i ag = _mm256_andnot_si256(rb, px);
+    __m256i rbPx = _mm256_and_si256(rb, px);
+    return _mm256_or_si256(ag, _mm256_or_si256(_mm256_slli_epi32(rbPx, 16),
+                                               _mm256_srli_epi32(rbPx, 16)));
+}
+
+inline __m256i to565(__m256i px) {
+    __m256i v = _mm256_or_si256(
+        _mm256_and_si256(_mm256_srli_epi32(px, 3), _mm256_set1_epi32(0x001F)),
+        _mm256_or_si256(
+            _mm256_and_si256(_mm256_srli_epi32(px, 5),
+                             _mm256_set1_epi32(0x07E0)),
+            _mm256_and_si256(_mm256_srli_epi32(px, 8),
+                             _mm256_set1_epi32(0xF800))));
+    return _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+}
+
+void swapRedBlueRow(const unsigned char *src, unsigned char *dest,
+                    int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i px = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+        _mm256_storeu_si256((__m256i*)(dest + x * 4), swapRedBlue(px));
+    }
+    swapRedBlueRowScalar(src + x * 4, dest + x * 4, width - x);
+}
+
+void rgb565Row(const unsigned char *src, unsigned char *dest, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i lo = to565(_mm256_loadu_si256((const __m256i*)(src + x * 4)));
+        __m256i hi = to565(
+            _mm256_loadu_si256((const __m256i*)(src + x * 4 + 32)));
+        // packs works within 128 bit lanes; put the quarters back in order.
+        __m256i packed = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dest + x * 2), packed);
+    }
+    rgb565RowScalar(src + x * 4, dest + x * 2, width - x);
+}
+
+void rgb24Row(const unsigned char *src, unsigned char *dest, int width) {
+    const __m256i shuffle = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    int x = 0;
+    // Each half is stored as 16 bytes of which only 12 are pixels, so stop
+    // while the row still has room for the 4 byte overhang.
+    for (; x + 10 <= width; x += 8) {
+        __m256i px = _mm256_shuffle_epi8(
+            _mm256_loadu_si256((const __m256i*)(src + x * 4)), shuffle);
+        _mm_storeu_si128((__m128i*)(dest + x * 3),
+                         _mm256_castsi256_si128(px));
+        _mm_storeu_si128((__m128i*)(dest + x * 3 + 12),
+                         _mm256_extracti128_si256(px, 1));
+    }
+    rgb24RowScalar(src + x * 4, dest + x * 3, width - x);
+}
+
+#else
+
+void swapRedBlueRow(const unsigned char *src, unsigned char *dest,
+                    int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        _mm_storeu_si128((__m128i*)(dest + x * 4), swapRedBlue(px));
+    }
+    swapRedBlueRowScalar(src + x * 4, dest + x * 4, width - x);
+}
+
+void rgb565Row(const unsigned char *src, unsigned char *dest, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i lo = to565(_mm_loadu_si128((const __m128i*)(src + x * 4)));
+        __m128i hi = to565(
+            _mm_loadu_si128((const __m128i*)(src + x * 4 + 16)));
+        _mm_storeu_si128((__m128i*)(dest + x * 2), _mm_packs_epi32(lo, hi));
+    }
+    rgb565RowScalar(src + x * 4, dest + x * 2, width - x);
+}
+
+// SSE2 has no byte shuffle, and 3 byte pixels do not fit its lanes.
+void rgb24Row(const unsigned char *src, unsigned char *dest, int width) {
+    rgb24RowScalar(src, dest, width);
+}
+
+#endif
+
+// Opaque pixels only need their channels moved; the table lookup is kept for
+// blocks that contain some transparency.
+template <bool swapRB>
+void unpremultiplyRow(const unsigned char *src, unsigned char *dest,
+                      int width) {
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        if (allOpaque(px)) {
+            _mm_storeu_si128((__m128i*)(dest + x * 4),
+                             swapRB ? swapRedBlue(px) : px);
+        } else {
+            unpremultiplyRowScalar<swapRB>(src + x * 4, dest + x * 4, 4);
+        }
+    }
+    unpremultiplyRowScalar<swapRB>(src + x * 4, dest + x * 4, width - x);
+}
+
+// Checks 16 pixels per compare, so mostly opaque pages cost about one
+// load per pixel.
+bool opaqueRow(const unsigned char *src, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *p = (const __m128i*)(src + x * 4);
+        __m128i px = _mm_and_si128(
+            _mm_and_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+            _mm_and_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+        if (!allOpaque(px)) {
+            return false;
+        }
+    }
+    return opaqueRowScalar(src + x * 4, width - x);
+}
+
+//////// NEON ////////
+
+#elif BERKELIUM_PIXEL_NEON
+
+void swapRedBlueRow(const unsigned char *src, unsigned char *dest,
+                    int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(src + x * 4);
+        uint8x16_t blue = px.val[0];
+        px.val[0] = px.val[2];
+        px.val[2] = blue;
+        vst4q_u8(dest + x * 4, px);
+    }
+    swapRedBlueRowScalar(src + x * 4, dest + x * 4, width - x);
+}
+
+void rgb565Row(const unsigned char *src, unsigned char *dest, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t px = vld4_u8(src + x * 4);
+        uint16x8_t v = vshll_n_u8(px.val[2], 8);
+        v = vsriq_n_u16(v, vshll_n_u8(px.val[1], 8), 5);
+        v = vsriq_n_u16(v, vshll_n_u8(px.val[0], 8), 11);
+        vst1q_u8(dest + x * 2, vreinterpretq_u8_u16(v));
+    }
+    rgb565RowScalar(src + x * 4, dest + x * 2, width - x);
+}
+
+void rgb24Row(const unsigned char *src, unsigned char *dest, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(src + x * 4);
+        uint8x16x3_t rgb;
+        rgb.val[0] = px.val[2];
+        rgb.val[1] = px.val[1];
+        rgb.val[2] = px.val[0];
+        vst3q_u8(dest + x * 3, rgb);
+    }
+    rgb24RowScalar(src + x * 4, dest + x * 3, width - x);
+}
+
+template <bool swapRB>
+void unpremultiplyRow(const unsigned char *src, unsigned char *dest,
+                      int width) {
+    unpremultiplyRowScalar<swapRB>(src, dest, width);
+}
+
+bool opaqueRow(const unsigned char *src, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t alpha = vld4q_u8(src + x * 4).val[3];
+        uint8x8_t half = vand_u8(vget_low_u8(alpha), vget_high_u8(alpha));
+        if (vget_lane_u64(vreinterpret_u64_u8(half), 0) != ~0ULL) {
+            return false;
+        }
+    }
+    return opaqueRowScalar(src + x * 4, width - x);
+}
+
+//////// Scalar only ////////
+
+#else
+
+void swapRedBlueRow(const unsigned char *src, unsigned char *dest,
+                    int width) {
+    swapRedBlueRowScalar(src, dest, width);
+}
+
+void rgb565Row(const unsigned char *src, unsigned char *dest, int width) {
+    rgb565RowScalar(src, dest, width);
+}
+
+void rgb24Row(const unsigned char *src, unsigned char *dest, int width) {
+    rgb24RowScalar(src, dest, width);
+}
+
+template <bool swapRB>
+void unpremultiplyRow(const unsigned char *src, unsigned char *dest,
+                      int width) {
+    unpremultiplyRowScalar<swapRB>(src, dest, width);
+}
+
+bool opaqueRow(const unsigned char *src, int width) {
+    return opaqueRowScalar(src, width);
+}
+
+#endif
+
+RowConverter rowConverter(PixelFormat format) {
+    switch (format) {
+      case PIXEL_FORMAT_RGBA:
+        return swapRedBlueRow;
+      case PIXEL_FORMAT_BGRA_UNPREMULTIPLIED:
+        return unpremultiplyRow<false>;
+      case PIXEL_FORMAT_RGBA_UNPREMULTIPLIED:
+        return unpremultiplyRow<true>;
+      case PIXEL_FORMAT_RGB24:
+        return rgb24Row;
+      case PIXEL_FORMAT_RGB565:
+        return rgb565Row;
+      case PIXEL_FORMAT_BGRA:
+      default:
+        return copyRow;
+    }
+}
+
+}
+
+void convertPixels(PixelFormat format,
+                   const unsigned char *src, size_t srcStride,
+                   unsigned char *dest, size_t destStride,
+                   int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    RowConverter convert = rowConverter(format);
+    for (int y = 0; y < height; ++y) {
+        convert(src, dest, width);
+        src += srcStride;
+        dest += destStride;
+    }
+}
+
+void findOpaqueRows(const unsigned char *bgra, size_t stride,
+                    const Rect &rect, std::vector<Rect> &opaque) {
+    if (rect.isEmpty()) {
+        return;
+    }
+    const unsigned char *row = bgra + rect.top() * stride + rect.left() * 4;
+    int runStart = -1;
+    for (int y = rect.top(); y <= rect.bottom(); ++y, row += stride) {
+        bool opaqueHere = y < rect.bottom() && opaqueRow(row, rect.width());
+        if (opaqueHere && runStart < 0) {
+            runStart = y;
+        } else if (!opaqueHere && runStart >= 0) {
+            Rect run;
+            run.mLeft = rect.left();
+            run.mTop = runStart;
+            run.mWidth = rect.width();
+            run.mHeight = y - runStart;
+            opaque.push_back(run);
+            runStart = -1;
+        }
+    }
+}
+
+}
@@ -0,0 +1,59 @@
+/*  Berkelium Implementation
+ *  PixelConvert.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_PIXELCONVERT_HPP_
+#define _BERKELIUM_PIXELCONVERT_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/PixelFormat.hpp"
+#include "berkelium/Rect.hpp"
+#include <vector>
+
+namespace Berkelium {
+
+// Converts a width x height block of premultiplied BGRA pixels, as held by a
+// Canvas, into |format|. Uses AVX2, SSE2 or NEON kernels when the compiler
+// targets them, with a scalar fallback for everything else.
+void convertPixels(PixelFormat format,
+                   const unsigned char *src, size_t srcStride,
+                   unsigned char *dest, size_t destStride,
+                   int width, int height);
+
+// Appends to |opaque| the parts of |rect| whose pixels all have alpha 255,
+// as one rect for each run of fully opaque rows. |bgra| is premultiplied
+// BGRA whose top left pixel is at (0, 0) of |rect|'s coordinates.
+void findOpaqueRows(const unsigned char *bgra, size_t stride,
+                    const Rect &rect, std::vector<Rect> &opaque);
+
+}
+
+#endif
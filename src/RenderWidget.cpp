@@ -38,16 +38,8 @@
 #include <gtk/gtkwindow.h>
 #endif
 
-#if defined (OS_WIN)
-#include <windows.h> // for GetTickCount()
-#elif defined (OS_POSIX)
-#include <sys/time.h>
-#include <time.h>
-#endif
-
-
-
 #include "berkelium/Platform.hpp"
+#include "berkelium/Berkelium.hpp"
 #include "RenderWidget.hpp"
 #include "WindowImpl.hpp"
 
@@ -61,6 +53,8 @@ void Widget::destroy(){
 
 RenderWidget::RenderWidget(WindowImpl *winImpl, int id) {
     mFocused = true;
+    mHidden = false;
+    mTextInputType = WebKit::WebTextInputTypeNone;
     mBacking = NULL;
     mWindow = winImpl;
 
@@ -111,10 +105,27 @@ RenderWidgetHost* RenderWidget::GetRenderWidgetHost() const{
 
   // Notifies the View that it has become visible.
 void RenderWidget::DidBecomeSelected(){
+    if (!mHidden) {
+        return;
+    }
+    mHidden = false;
+    if (mHost) {
+        // Without a backing store, this asks the renderer for a full paint.
+        mHost->WasRestored();
+    }
 }
 
   // Notifies the View that it has been hidden.
 void RenderWidget::WasHidden(){
+    if (mHidden) {
+        return;
+    }
+    mHidden = true;
+    if (mHost) {
+        // The renderer stops painting and, once every widget in the process
+        // is hidden, the process is backgrounded.
+        mHost->WasHidden();
+    }
 }
 
   // Tells the View to size itself to the specified size.
@@ -139,7 +150,7 @@ void RenderWidget::Blur(){
 
   // Returns true if the view is showing
 bool RenderWidget::IsShowing(){
-    return true;
+    return !mHidden;
 }
   // Returns true if the View currently has the focus.
 bool RenderWidget::HasFocus(){
@@ -149,8 +160,10 @@ bool RenderWidget::HasFocus(){
   // Shows/hides the view.  These must always be called together in pairs.
   // It is not legal to call Hide() multiple times in a row.
 void RenderWidget::Show(){
+    DidBecomeSelected();
 }
 void RenderWidget::Hide(){
+    WasHidden();
 }
 
   // Retrieve the bounds of the View, in screen coordinates.
@@ -169,6 +182,7 @@ void RenderWidget::SetIsLoading(bool is_loading){
 
   // Enable or disable IME for the view.
 void RenderWidget::ImeUpdateTextInputState(WebKit::WebTextInputType type, const gfx::Rect& caret_rect){
+    mTextInputType = type;
 }
 
 void RenderWidget::ImeCancelComposition() {
@@ -414,24 +428,52 @@ bool RenderWidget::hasFocus() const {
 }
 
 template<class T>
-void zeroWebEvent(T &event, int modifiers, WebKit::WebInputEvent::Type t) {
+void zeroWebEvent(T &event, int modifiers, WebKit::WebInputEvent::Type t,
+                  double timestamp) {
     memset(&event,0,sizeof(T));
     event.type=t;
     event.size=sizeof(T);
     event.modifiers=modifiers;
-#ifdef _WIN32
-    event.timeStampSeconds=GetTickCount()/1000.0;
-#else
-    timeval tv;
-    gettimeofday(&tv,NULL);
-    event.timeStampSeconds=((double)tv.tv_usec)/1000000.0;
-    event.timeStampSeconds+=tv.tv_sec;
-#endif
+    event.timeStampSeconds=timestamp;
+}
+
+// Latency samples are in microseconds on the Berkelium::monotonicTime
+// clock, so caller-supplied event times can be compared with paints.
+static long long latencyMicros(double seconds) {
+    return (long long)(seconds * 1000000.0);
+}
+
+static long long latencyNow() {
+    return latencyMicros(Berkelium::monotonicTime());
+}
+
+double RenderWidget::inputTimestamp() const {
+    double timestamp = mWindow->getInputTimestamp();
+    return timestamp > 0 ? timestamp : Berkelium::monotonicTime();
+}
+
+long long RenderWidget::latencyStart(double eventTime) const {
+    double start = mWindow->getInputLatencyStart();
+    return latencyMicros(start > 0 ? start : eventTime);
+}
+
+void RenderWidget::inputHandled() {
+    mLatency.inputHandled(latencyNow(), mWindow->latencyStats());
+}
+
+void RenderWidget::paintReceived() {
+    mLatency.paintReceived(latencyNow(), mWindow->latencyStats(),
+                           mWindow->getWidget() == this &&
+                           mWindow->presentsOnRequest());
+}
+
+void RenderWidget::paintPresented() {
+    mLatency.paintPresented(latencyNow(), mWindow->latencyStats());
 }
 
 void RenderWidget::mouseMoved(int xPos, int yPos) {
     WebKit::WebMouseEvent event;
-    zeroWebEvent(event, mModifiers, WebKit::WebInputEvent::MouseMove);
+    zeroWebEvent(event, mModifiers, WebKit::WebInputEvent::MouseMove, inputTimestamp());
 	event.x = xPos;
 	event.y = yPos;
 	event.globalX = xPos+mRect.x();
@@ -444,12 +486,14 @@ void RenderWidget::mouseMoved(int xPos, int yPos) {
 
 	if (GetRenderWidgetHost()) {
 		GetRenderWidgetHost()->ForwardMouseEvent(event);
+		mLatency.inputSent(InputLatencyTracker::INPUT_MOUSE_MOVE,
+		                   latencyStart(event.timeStampSeconds));
 	}
 }
 
 void RenderWidget::mouseWheel(int scrollX, int scrollY) {
 	WebKit::WebMouseWheelEvent event;
-	zeroWebEvent(event, mModifiers, WebKit::WebInputEvent::MouseWheel);
+	zeroWebEvent(event, mModifiers, WebKit::WebInputEvent::MouseWheel, inputTimestamp());
 	event.x = mMouseX;
 	event.y = mMouseY;
 	event.windowX = mMouseX; // PRHFIXME: Window vs Global position?
@@ -467,6 +511,8 @@ void RenderWidget::mouseWheel(int scrollX, int scrollY) {
 
 	if (GetRenderWidgetHost()) {
 		GetRenderWidgetHost()->ForwardWheelEvent(event);
+		mLatency.inputSent(InputLatencyTracker::INPUT_MOUSE_WHEEL,
+		                   latencyStart(event.timeStampSeconds));
 	}
 }
 
@@ -489,7 +535,7 @@ void RenderWidget::mouseButton(unsigned int mouseButton, bool down) {
         mModifiers&=(~buttonChangeMask);
     }
     WebKit::WebMouseEvent event;
-    zeroWebEvent(event, mModifiers, down?WebKit::WebInputEvent::MouseDown:WebKit::WebInputEvent::MouseUp);
+    zeroWebEvent(event, mModifiers, down?WebKit::WebInputEvent::MouseDown:WebKit::WebInputEvent::MouseUp, inputTimestamp());
     switch(mouseButton) {
       case 0:
         event.button = WebKit::WebMouseEvent::ButtonLeft;
@@ -515,12 +561,14 @@ void RenderWidget::mouseButton(unsigned int mouseButton, bool down) {
 	event.globalY = mMouseY+mRect.y();
 	if (GetRenderWidgetHost()) {
 		GetRenderWidgetHost()->ForwardMouseEvent(event);
+		mLatency.inputSent(InputLatencyTracker::INPUT_DISCRETE,
+		                   latencyStart(event.timeStampSeconds));
 	}
 }
 
 void RenderWidget::keyEvent(bool pressed, int modifiers, int vk_code, int scancode){
 	NativeWebKeyboardEvent event;
-	zeroWebEvent(event, mModifiers, pressed?WebKit::WebInputEvent::RawKeyDown:WebKit::WebInputEvent::KeyUp);
+	zeroWebEvent(event, mModifiers, pressed?WebKit::WebInputEvent::RawKeyDown:WebKit::WebInputEvent::KeyUp, inputTimestamp());
 	event.windowsKeyCode = vk_code;
 	event.nativeKeyCode = scancode;
 	event.text[0]=0;
@@ -545,6 +593,8 @@ void RenderWidget::keyEvent(bool pressed, int modifiers, int vk_code, int scanco
 
 	if (GetRenderWidgetHost()) {
 		GetRenderWidgetHost()->ForwardKeyboardEvent(event);
+		mLatency.inputSent(InputLatencyTracker::INPUT_DISCRETE,
+		                   latencyStart(event.timeStampSeconds));
 	}
 	// keep track of persistent modifiers.
     unsigned int test=(WebKit::WebInputEvent::LeftButtonDown|WebKit::WebInputEvent::MiddleButtonDown|WebKit::WebInputEvent::RightButtonDown);
@@ -559,9 +609,10 @@ void RenderWidget::textEvent(const wchar_t * text, size_t textLength) {
 void RenderWidget::textEvent(WideString wideText) {
 	// generate one of these events for each lengthCap chunks.
 	// 1 less because we need to null terminate.
-    if (!GetRenderWidgetHost()) {
-		return;
-	}
+    RenderWidgetHost *host = GetRenderWidgetHost();
+    if (!host) {
+        return;
+    }
 
     string16 text16;
     if (!WideToUTF16(wideText.data(), wideText.length(), &text16)) {
@@ -569,10 +620,20 @@ void RenderWidget::textEvent(WideString wideText) {
         return;
     }
 
+    size_t bulkThreshold = mWindow->getBulkTextThreshold();
+    if (bulkThreshold && text16.length() >= bulkThreshold &&
+        mTextInputType != WebKit::WebTextInputTypeNone) {
+        // Inserts the whole string with one message and one edit command,
+        // rather than one keyboard event round trip per character. This is
+        // not an input event and gets no ACK, so it is not timed.
+        host->ImeConfirmComposition(text16);
+        return;
+    }
+
     // assert(WebKit::WebKeyboardEvent::textLengthCap > 2);
 
 	NativeWebKeyboardEvent event;
-	zeroWebEvent(event,mModifiers,WebKit::WebInputEvent::Char);
+	zeroWebEvent(event,mModifiers,WebKit::WebInputEvent::Char,inputTimestamp());
 	event.isSystemKey = false;
 	event.windowsKeyCode = 0;
 	event.nativeKeyCode = 0;
@@ -589,7 +650,9 @@ void RenderWidget::textEvent(WideString wideText) {
             // Otherwise, only send one at a time.
             event.text[1] = event.unmodifiedText[1] = 0;
         }
-        GetRenderWidgetHost()->ForwardKeyboardEvent(event);
+        host->ForwardKeyboardEvent(event);
+        mLatency.inputSent(InputLatencyTracker::INPUT_DISCRETE,
+                           latencyStart(event.timeStampSeconds));
 	}
 }
 
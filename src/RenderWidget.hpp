@@ -34,6 +34,7 @@
 #define _BERKELIUM_RENDERWIDGET_HPP_
 
 #include "berkelium/Widget.hpp"
+#include "InputLatency.hpp"
 #include "chrome/browser/renderer_host/render_widget_host.h"
 #include "chrome/browser/renderer_host/render_widget_host_view.h"
 #if defined(OS_MACOSX)
@@ -71,6 +72,19 @@ public:
 
     void textEvent(WideString text);
 
+    // Time to stamp the event being sent with, see
+    // WindowImpl::getInputTimestamp.
+    double inputTimestamp() const;
+    // Where latency of an event stamped |eventTime| starts, in
+    // microseconds: the first of the events injectInput coalesced into it.
+    long long latencyStart(double eventTime) const;
+
+    // Latency tracing, see InputLatencyTracker. Samples are recorded in
+    // the Window's LatencyStats.
+    void inputHandled();
+    void paintReceived();
+    void paintPresented();
+
 public: /******* RenderWidgetHostView *******/
 
   // Perform all the initialization steps necessary for this object to represent
@@ -233,6 +247,10 @@ private:
 
     RenderWidgetHost *mHost;
     bool mFocused;
+    // Set by WasHidden; the renderer is not painting this widget.
+    bool mHidden;
+    // Kind of field focused in the renderer, from ImeUpdateTextInputState.
+    WebKit::WebTextInputType mTextInputType;
     BackingStore* mBacking;
     int mId;
     std::wstring mTooltip;
@@ -241,6 +259,8 @@ private:
 
     gfx::Rect mRect;
 
+    InputLatencyTracker mLatency;
+
 #if defined(OS_MACOSX)
   // Helper class for managing instances of accelerated plug-ins.
   AcceleratedSurfaceContainerManagerMac plugin_container_manager_;
@@ -34,6 +34,8 @@
 #include "berkelium/Berkelium.hpp"
 #include "Root.hpp"
 #include "MemoryRenderViewHost.hpp"
+#include "PaintWorkerPool.hpp"
+#include "WindowImpl.hpp"
 
 // Chromium headers
 #include "base/message_loop.h"
@@ -288,6 +290,7 @@ Root::Root (FileString homeDirectory) {
     mTimerMgr.reset(new HighResolutionTimerManager);
     mUIThread.reset(new ChromeThread(ChromeThread::UI, mMessageLoop.get()));
     mErrorHandler = 0;
+    mFrameBatchDelegate = NULL;
 
     mProcessSingleton.reset(new ProcessSingleton(homedirpath));
     BrowserProcessImpl *browser_process;
@@ -462,12 +465,72 @@ void Root::stopRunning() {
 
 void Root::update() {
     MessageLoopForUI::current()->RunAllPending();
+    if (mPaintWorkers.get()) {
+        mPaintWorkers->finishPending();
+    }
+    deliverFrameBatch();
+}
+
+void Root::setFrameBatchDelegate(FrameBatchDelegate *delegate) {
+    // Anything already queued still goes to the delegate it was queued for.
+    deliverFrameBatch();
+    mFrameBatchDelegate = delegate;
+}
+
+void Root::queueFrameBatch(WindowImpl *window) {
+    mFrameBatchWindows.push_back(window);
+}
+
+void Root::forgetFrameBatch(WindowImpl *window) {
+    for (size_t i = 0; i < mFrameBatchWindows.size(); ++i) {
+        if (mFrameBatchWindows[i] == window) {
+            mFrameBatchWindows.erase(mFrameBatchWindows.begin() + i);
+            return;
+        }
+    }
+}
+
+void Root::deliverFrameBatch() {
+    if (mFrameBatchWindows.empty()) {
+        return;
+    }
+    mFrameUpdates.clear();
+    mFrameDirtyRects.clear();
+    for (size_t i = 0; i < mFrameBatchWindows.size(); ++i) {
+        mFrameBatchWindows[i]->takeFrameUpdates(mFrameUpdates,
+                                                mFrameDirtyRects);
+    }
+    // Every window has handed over its damage, so the delegate is free to
+    // destroy windows or queue new paints.
+    mFrameBatchWindows.clear();
+    if (mFrameUpdates.empty() || !mFrameBatchDelegate) {
+        return;
+    }
+    size_t nextRect = 0;
+    for (size_t i = 0; i < mFrameUpdates.size(); ++i) {
+        mFrameUpdates[i].mDirtyRects = &mFrameDirtyRects[nextRect];
+        nextRect += mFrameUpdates[i].mNumDirtyRects;
+    }
+    mFrameBatchDelegate->onFrameBatch(mFrameUpdates.size(),
+                                      &mFrameUpdates[0]);
+}
+
+void Root::setPaintThreads(unsigned int numThreads) {
+    if (mPaintWorkers.get()) {
+        mPaintWorkers->finishPending();
+    }
+    mPaintWorkers.reset(numThreads ? new PaintWorkerPool(numThreads) : NULL);
+    if (mPaintWorkers.get() && !mPaintWorkers->size()) {
+        // No thread could be started; keep painting on the UI thread.
+        mPaintWorkers.reset();
+    }
 }
 
 Root::~Root(){
     // FIXME: RemoveProfile gone--do we leak profiles?
     //g_browser_process->profile_manager()->RemoveProfile(mProf);
 
+    mPaintWorkers.reset();
     g_browser_process->EndSession();
     mRenderViewHostFactory.reset();
     mTimerMgr.reset();
@@ -33,12 +33,14 @@
 #include "berkelium/Platform.hpp"
 #include "berkelium/Berkelium.hpp"
 #include "berkelium/Singleton.hpp"
+#include "berkelium/FrameBatch.hpp"
 #include "chrome/browser/profile.h"
 #include "chrome/common/notification_service.h"
 #include "base/scoped_nsautorelease_pool.h"
 #include "base/ref_counted.h"
 #include "base/message_loop.h"
 #include "base/scoped_ptr.h"
+#include <vector>
 
 class BrowserRenderProcessHost;
 class ProcessSingleton;
@@ -55,6 +57,9 @@ namespace Berkelium {
 
 class MemoryRenderViewHostFactory;
 class ErrorDelegate;
+class PaintWorkerPool;
+class WindowImpl;
+class FrameBatchDelegate;
 
 //singleton class that contains chromium singletons. Not visible outside of Berkelium library core
 class Root : public AutoSingleton<Root> {
@@ -71,6 +76,12 @@ class Root : public AutoSingleton<Root> {
     base::ScopedNSAutoreleasePool mAutoreleasePool;
     scoped_refptr<HistogramSynchronizer> mHistogramSynchronizer;
     scoped_ptr<StatisticsRecorder> mStatistics;
+    scoped_ptr<PaintWorkerPool> mPaintWorkers;
+    FrameBatchDelegate *mFrameBatchDelegate;
+    // Windows with canvas changes for the next frame batch.
+    std::vector<WindowImpl*> mFrameBatchWindows;
+    std::vector<FrameUpdate> mFrameUpdates;
+    std::vector<Rect> mFrameDirtyRects;
 
     ErrorDelegate* mErrorHandler;
 public:
@@ -80,6 +91,8 @@ public:
 //    void runUntilStopped();
 //    void stopRunning();
     void update();
+    // Hands the queued canvas changes to the FrameBatchDelegate.
+    void deliverFrameBatch();
 
     void setErrorHandler(ErrorDelegate *errorHandler) {
         mErrorHandler = errorHandler;
@@ -89,6 +102,21 @@ public:
         return mErrorHandler;
     }
 
+    void setPaintThreads(unsigned int numThreads);
+
+    void setFrameBatchDelegate(FrameBatchDelegate *delegate);
+    FrameBatchDelegate *getFrameBatchDelegate() const {
+        return mFrameBatchDelegate;
+    }
+    // Asks for window->takeFrameUpdates at the end of this update().
+    void queueFrameBatch(WindowImpl *window);
+    void forgetFrameBatch(WindowImpl *window);
+
+    // NULL unless setPaintThreads asked for, and started, worker threads.
+    PaintWorkerPool *getPaintWorkers() const {
+        return mPaintWorkers.get();
+    }
+
     ProcessSingleton *getProcessSingleton(){
         return mProcessSingleton.get();
     }
@@ -0,0 +1,240 @@
+/*  Berkelium Implementation
+ *  Thumbnailer.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Thumbnailer.hpp"
+#include "Canvas.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BERKELIUM_THUMBNAIL_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define BERKELIUM_THUMBNAIL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Berkelium {
+
+namespace {
+
+// Averages 2x2 blocks of row0/row1 into dest pixels [x, endX). The last
+// source column is reused when srcWidth is odd.
+void downsampleRowScalar(const unsigned char *row0, const unsigned char *row1,
+                         int srcWidth, unsigned char *dest, int x, int endX) {
+    for (; x < endX; ++x) {
+        const int s0 = 2 * x * 4;
+        const int s1 = (2 * x + 1 < srcWidth ? 2 * x + 1 : srcWidth - 1) * 4;
+        for (int c = 0; c < 4; ++c) {
+            dest[x * 4 + c] = (unsigned char)(
+                (row0[s0 + c] + row0[s1 + c] +
+                 row1[s0 + c] + row1[s1 + c] + 2) >> 2);
+        }
+    }
+}
+
+void downsampleRow(const unsigned char *row0, const unsigned char *row1,
+                   int srcWidth, unsigned char *dest, int x, int endX) {
+    // Pixels whose 2x2 block lies entirely inside the source row.
+    const int fullEnd = endX < srcWidth / 2 ? endX : srcWidth / 2;
+#if defined(BERKELIUM_THUMBNAIL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; x + 4 <= fullEnd; x += 4) {
+        const __m128i *s0 = (const __m128i*)(row0 + x * 8);
+        const __m128i *s1 = (const __m128i*)(row1 + x * 8);
+        __m128i out[2];
+        for (int half = 0; half < 2; ++half) {
+            __m128i a = _mm_loadu_si128(s0 + half);
+            __m128i b = _mm_loadu_si128(s1 + half);
+            // Column sums of source pixels 0,1 and 2,3 as 16-bit channels.
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                       _mm_unpacklo_epi8(b, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                       _mm_unpackhi_epi8(b, zero));
+            lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+            out[half] = _mm_srli_epi16(
+                _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+        }
+        _mm_storeu_si128((__m128i*)(dest + x * 4),
+                         _mm_packus_epi16(out[0], out[1]));
+    }
+#elif defined(BERKELIUM_THUMBNAIL_NEON)
+    for (; x + 4 <= fullEnd; x += 4) {
+        // Splits 8 source pixels into even and odd columns.
+        uint32x4x2_t a = vld2q_u32((const uint32_t*)(row0 + x * 8));
+        uint32x4x2_t b = vld2q_u32((const uint32_t*)(row1 + x * 8));
+        uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]);
+        uint8x16_t a1 = vreinterpretq_u8_u32(a.val[1]);
+        uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]);
+        uint8x16_t b1 = vreinterpretq_u8_u32(b.val[1]);
+        uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a0), vget_low_u8(a1)),
+                                  vaddl_u8(vget_low_u8(b0), vget_low_u8(b1)));
+        uint16x8_t hi = vaddq_u16(
+            vaddl_u8(vget_high_u8(a0), vget_high_u8(a1)),
+            vaddl_u8(vget_high_u8(b0), vget_high_u8(b1)));
+        vst1q_u8(dest + x * 4,
+                 vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+    }
+#endif
+    downsampleRowScalar(row0, row1, srcWidth, dest, x, endX);
+}
+
+// Filters |destRect| of a level from the level above it.
+void downsample(const unsigned char *src, int srcWidth, int srcHeight,
+                unsigned char *dest, int destWidth, const Rect &destRect) {
+    const size_t srcStride = (size_t)srcWidth * 4;
+    for (int y = destRect.top(); y < destRect.bottom(); ++y) {
+        const int sy1 = 2 * y + 1 < srcHeight ? 2 * y + 1 : srcHeight - 1;
+        downsampleRow(src + 2 * y * srcStride, src + sy1 * srcStride,
+                      srcWidth, dest + (size_t)y * destWidth * 4,
+                      destRect.left(), destRect.right());
+    }
+}
+
+Rect halveRect(const Rect &rect) {
+    Rect half;
+    half.mLeft = rect.left() / 2;
+    half.mTop = rect.top() / 2;
+    half.mWidth = (rect.right() + 1) / 2 - half.mLeft;
+    half.mHeight = (rect.bottom() + 1) / 2 - half.mTop;
+    return half;
+}
+
+}
+
+Thumbnailer::Thumbnailer()
+    : mShift(1), mMaxWidth(0), mMaxHeight(0),
+      mSourceWidth(0), mSourceHeight(0) {
+}
+
+void Thumbnailer::setScaleShift(int shift) {
+    mShift = shift < 0 ? 0 :
+        shift > kMaxScaleShift ? kMaxScaleShift : shift;
+    mMaxWidth = 0;
+    mMaxHeight = 0;
+}
+
+void Thumbnailer::setMaxSize(int maxWidth, int maxHeight) {
+    mMaxWidth = maxWidth > 1 ? maxWidth : 1;
+    mMaxHeight = maxHeight > 1 ? maxHeight : 1;
+}
+
+int Thumbnailer::chooseShift(int width, int height) const {
+    if (!mMaxWidth) {
+        return mShift;
+    }
+    int shift = 0;
+    while (shift < kMaxScaleShift &&
+           (width > mMaxWidth || height > mMaxHeight)) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        ++shift;
+    }
+    return shift;
+}
+
+void Thumbnailer::resize(int width, int height, int shift) {
+    mSourceWidth = width;
+    mSourceHeight = height;
+    mLevels.resize(shift);
+    for (int i = 0; i < shift; ++i) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        mLevels[i].mWidth = width;
+        mLevels[i].mHeight = height;
+        mLevels[i].mPixels.resize((size_t)width * height * 4);
+    }
+}
+
+void Thumbnailer::update(const Canvas &canvas,
+                         size_t numRects, const Rect *rects) {
+    const int shift = chooseShift(canvas.width(), canvas.height());
+    DirtyRegion *damage = &mLevelDamage[0];
+    damage->clear();
+    if (canvas.width() != mSourceWidth || canvas.height() != mSourceHeight ||
+        shift != (int)mLevels.size()) {
+        resize(canvas.width(), canvas.height(), shift);
+        mDamage.clear();
+        damage->add(canvas.rect());
+    } else {
+        for (size_t i = 0; i < numRects; ++i) {
+            damage->add(rects[i].intersect(canvas.rect()));
+        }
+    }
+    if (damage->empty()) {
+        return;
+    }
+
+    const unsigned char *src = canvas.data();
+    int srcWidth = canvas.width();
+    int srcHeight = canvas.height();
+    for (int i = 0; i < shift; ++i) {
+        Level &level = mLevels[i];
+        DirtyRegion *next = &mLevelDamage[(i + 1) % 2];
+        next->clear();
+        for (size_t r = 0; r < damage->size(); ++r) {
+            next->add(halveRect(damage->rects()[r]));
+        }
+        for (size_t r = 0; r < next->size(); ++r) {
+            downsample(src, srcWidth, srcHeight,
+                       &level.mPixels[0], level.mWidth, next->rects()[r]);
+        }
+        damage = next;
+        src = &level.mPixels[0];
+        srcWidth = level.mWidth;
+        srcHeight = level.mHeight;
+    }
+    mDamage.add(damage->size(), damage->rects());
+}
+
+const unsigned char *Thumbnailer::data(const Canvas &canvas) const {
+    if (mLevels.empty()) {
+        return canvas.data();
+    }
+    const Level &level = mLevels.back();
+    return level.mPixels.empty() ? NULL : &level.mPixels[0];
+}
+
+Rect Thumbnailer::rect() const {
+    Rect thumb = Rect();
+    if (mLevels.empty()) {
+        thumb.mWidth = mSourceWidth;
+        thumb.mHeight = mSourceHeight;
+    } else {
+        thumb.mWidth = mLevels.back().mWidth;
+        thumb.mHeight = mLevels.back().mHeight;
+    }
+    return thumb;
+}
+
+}
@@ -0,0 +1,102 @@
+/*  Berkelium Implementation
+ *  Thumbnailer.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_THUMBNAILER_HPP_
+#define _BERKELIUM_THUMBNAILER_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+#include "DirtyRegion.hpp"
+#include <vector>
+
+namespace Berkelium {
+
+class Canvas;
+
+// Keeps a downscaled copy of a Canvas as a chain of mip levels, each half
+// the size of the one before, built with a 2x2 box filter. Only the parts
+// of each level under new damage are filtered again, so an idle page costs
+// nothing. Levels round up, so odd edges average the pixels they have.
+class Thumbnailer {
+public:
+    static const int kMaxScaleShift = 8;
+
+    Thumbnailer();
+
+    // Uses level |shift|, i.e. 1/2^shift of the canvas size.
+    void setScaleShift(int shift);
+    // Uses the largest level that fits within maxWidth x maxHeight.
+    void setMaxSize(int maxWidth, int maxHeight);
+
+    // Refilters the levels under |rects| of |canvas|. Rebuilds everything if
+    // the canvas size or the chosen level changed.
+    void update(const Canvas &canvas, size_t numRects, const Rect *rects);
+
+    // Pixels of the chosen level in BGRA, with a stride of
+    // rect().width() * 4. At level 0 this is the canvas itself.
+    const unsigned char *data(const Canvas &canvas) const;
+    Rect rect() const;
+
+    // Area of the thumbnail changed since the last clearDamage.
+    const DirtyRegion &damage() const {
+        return mDamage;
+    }
+    void clearDamage() {
+        mDamage.clear();
+    }
+
+private:
+    struct Level {
+        int mWidth;
+        int mHeight;
+        std::vector<unsigned char> mPixels;
+    };
+
+    int chooseShift(int width, int height) const;
+    void resize(int width, int height, int shift);
+
+    int mShift;
+    int mMaxWidth;
+    int mMaxHeight;
+    int mSourceWidth;
+    int mSourceHeight;
+    // mLevels[i] holds level i + 1; level 0 is the canvas.
+    std::vector<Level> mLevels;
+    DirtyRegion mDamage;
+    // Damage of the level being filtered and of the next one, swapping
+    // roles on every level.
+    DirtyRegion mLevelDamage[2];
+};
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*  Berkelium Implementation
+ *  TileGrid.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TileGrid.hpp"
+
+namespace Berkelium {
+
+TileGrid::TileGrid() {
+    mWidth = 0;
+    mHeight = 0;
+    mTileSize = 0;
+    mColumns = 0;
+    mRows = 0;
+}
+
+void TileGrid::reset(int width, int height, int tileSize) {
+    mWidth = width > 0 ? width : 0;
+    mHeight = height > 0 ? height : 0;
+    mTileSize = tileSize > 0 ? tileSize : 1;
+    mColumns = (mWidth + mTileSize - 1) / mTileSize;
+    mRows = (mHeight + mTileSize - 1) / mTileSize;
+    mBits.assign((tileCount() + kBitsPerWord - 1) / kBitsPerWord, 0);
+}
+
+void TileGrid::markRect(const Rect &rect) {
+    Rect bounds;
+    bounds.mLeft = 0;
+    bounds.mTop = 0;
+    bounds.mWidth = mWidth;
+    bounds.mHeight = mHeight;
+    const Rect r = rect.intersect(bounds);
+    if (r.isEmpty()) {
+        return;
+    }
+    const int firstColumn = r.left() / mTileSize;
+    const int lastColumn = (r.right() - 1) / mTileSize;
+    const int firstRow = r.top() / mTileSize;
+    const int lastRow = (r.bottom() - 1) / mTileSize;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        size_t tile = (size_t)row * mColumns + firstColumn;
+        for (int column = firstColumn; column <= lastColumn; ++column, ++tile) {
+            mBits[tile / kBitsPerWord] |= 1u << (tile % kBitsPerWord);
+        }
+    }
+}
+
+void TileGrid::markAll() {
+    const size_t count = tileCount();
+    for (size_t word = 0; word < mBits.size(); ++word) {
+        mBits[word] = ~0u;
+    }
+    // Keep the bits past the last tile clear so nextDirty never returns them.
+    if (count % kBitsPerWord) {
+        mBits.back() = (1u << (count % kBitsPerWord)) - 1;
+    }
+}
+
+void TileGrid::clear() {
+    for (size_t word = 0; word < mBits.size(); ++word) {
+        mBits[word] = 0;
+    }
+}
+
+size_t TileGrid::nextDirty(size_t tile) const {
+    const size_t count = tileCount();
+    while (tile < count) {
+        unsigned int word = mBits[tile / kBitsPerWord] >> (tile % kBitsPerWord);
+        if (!word) {
+            tile = (tile / kBitsPerWord + 1) * kBitsPerWord;
+            continue;
+        }
+        while (!(word & 1)) {
+            word >>= 1;
+            ++tile;
+        }
+        return tile;
+    }
+    return count;
+}
+
+Rect TileGrid::tileRect(size_t tile) const {
+    const int column = (int)(tile % mColumns);
+    const int row = (int)(tile / mColumns);
+    Rect ret;
+    ret.mLeft = column * mTileSize;
+    ret.mTop = row * mTileSize;
+    ret.mWidth = mTileSize;
+    ret.mHeight = mTileSize;
+    if (ret.right() > mWidth) {
+        ret.mWidth = mWidth - ret.mLeft;
+    }
+    if (ret.bottom() > mHeight) {
+        ret.mHeight = mHeight - ret.mTop;
+    }
+    return ret;
+}
+
+}
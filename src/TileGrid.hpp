@@ -0,0 +1,97 @@
+/*  Berkelium Implementation
+ *  TileGrid.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_TILEGRID_HPP_
+#define _BERKELIUM_TILEGRID_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+#include <vector>
+
+namespace Berkelium {
+
+// Splits a surface into fixed-size square tiles, numbered in row-major
+// order, and keeps one dirty bit per tile. Tiles in the last row and column
+// are clipped to the surface.
+class TileGrid {
+public:
+    TileGrid();
+
+    // Lays out tiles over a width x height surface. All tiles start clean.
+    void reset(int width, int height, int tileSize);
+
+    int width() const {
+        return mWidth;
+    }
+    int height() const {
+        return mHeight;
+    }
+    int tileSize() const {
+        return mTileSize;
+    }
+    int columns() const {
+        return mColumns;
+    }
+    int rows() const {
+        return mRows;
+    }
+    size_t tileCount() const {
+        return (size_t)mColumns * mRows;
+    }
+
+    // Marks every tile touching |rect| as dirty.
+    void markRect(const Rect &rect);
+    void markAll();
+    void clear();
+
+    bool isDirty(size_t tile) const {
+        return (mBits[tile / kBitsPerWord] >> (tile % kBitsPerWord)) & 1;
+    }
+    // Returns the first dirty tile at or after |tile|, or tileCount() if
+    // there is none. Skips clean words 32 tiles at a time.
+    size_t nextDirty(size_t tile) const;
+    Rect tileRect(size_t tile) const;
+
+private:
+    static const size_t kBitsPerWord = 32;
+
+    std::vector<unsigned int> mBits;
+    int mWidth;
+    int mHeight;
+    int mTileSize;
+    int mColumns;
+    int mRows;
+};
+
+}
+
+#endif
@@ -36,8 +36,14 @@
 #include "WindowImpl.hpp"
 #include "MemoryRenderViewHost.hpp"
 #include "Root.hpp"
+#include "FrameLeaseImpl.hpp"
+#include "PaintWorkerPool.hpp"
+#include "PixelConvert.hpp"
 #include "berkelium/WindowDelegate.hpp"
 #include "berkelium/Cursor.hpp"
+#include "berkelium/DeltaStream.hpp"
+#include "berkelium/FrameCallback.hpp"
+#include "berkelium/FrameExchange.hpp"
 
 #include "base/file_util.h"
 #include "base/file_version_info.h"
@@ -65,11 +71,45 @@
 #endif
 
 namespace Berkelium {
+
+// Initial room in the copy rect arena; the renderer rarely sends more rects
+// than this in one paint, so it normally never has to grow.
+static const size_t kInitialPaintRects = 16;
+
 //WindowImpl temp;
 void WindowImpl::init(SiteInstance*site, int routing_id) {
     mId = routing_id;
     received_page_title_=false;
     is_crashed_=false;
+    mLeasedFrames=false;
+    mVisible=true;
+    mReleaseHiddenSurfaces=false;
+    mDeltaEncoder=NULL;
+    mFrameExchange=NULL;
+    mBulkTextThreshold=256;
+    mInputTimestamp=0;
+    mInputLatencyStart=0;
+    mCanvas=NULL;
+    mOutputFormat=PIXEL_FORMAT_BGRA;
+    mOutput=NULL;
+    mYuvFormat=YUV_FORMAT_NONE;
+    mYuv=NULL;
+    mTileSize=0;
+    mDamageFilter=NULL;
+    mThumbnailer=NULL;
+    mOpaqueDetection=false;
+    mWidgetCompositing=false;
+    mPaintOnDemand=false;
+    mFrameCallback=NULL;
+    mFrameWaitsForPaint=false;
+    mPageCanvas=NULL;
+    mFrameBatchQueued=false;
+    mRawDamage.setMergePolicy(DirtyRegion::kUnlimitedRects, -1);
+    configurePaintDamage();
+    mPaintRectArena.reserve(kInitialPaintRects);
+    // Pixels between the renderer's rects are garbage, so rects delivered
+    // straight from its buffer may be split but never merged.
+    mSourceDamage.setMergePolicy(DirtyRegion::kUnlimitedRects, -1);
     mRenderViewHost = RenderViewHostFactory::Create(
         site,
         this,
@@ -103,10 +143,22 @@ WindowImpl::WindowImpl(const Context*otherContext, int routing_id):
     CreateRenderViewForRenderManager(host(), true);
 }
 WindowImpl::~WindowImpl() {
+    PaintWorkerPool *workers = Root::getSingleton().getPaintWorkers();
+    if (workers) {
+        workers->forgetWindow(this);
+    }
+    Root::getSingleton().forgetFrameBatch(this);
+    clearWidgetCanvases();
     RenderViewHost* render_view_host = mRenderViewHost;
     mRenderViewHost = NULL;
     render_view_host->Shutdown();
     delete mController;
+    delete mDamageFilter;
+    delete mThumbnailer;
+    delete mOutput;
+    delete mYuv;
+    delete mPageCanvas;
+    delete mCanvas;
 }
 
 RenderProcessHost *WindowImpl::process() const {
@@ -172,6 +224,435 @@ void WindowImpl::setTransparent(bool istrans) {
     }
 }
 
+void WindowImpl::setOpaqueDetection(bool enabled) {
+    waitForPaintWorkers();
+    mOpaqueDetection = enabled;
+    mOpaqueRects.clear();
+}
+
+void WindowImpl::setLeasedFrames(bool leased) {
+    mLeasedFrames = leased;
+    if (leased && mPaintOnDemand) {
+        // Paint on demand is off while leasing, see holdsPaintAck.
+        mFrameCallback = NULL;
+        mFrameWaitsForPaint = false;
+        mFrameTimer.Stop();
+        releaseHeldPaintAck();
+    }
+}
+
+void WindowImpl::setVisible(bool visible) {
+    if (visible == mVisible) {
+        return;
+    }
+    mVisible = visible;
+    // Popups and select boxes paint on their own, so they are hidden too.
+    for (BackToFrontIter iter = backIter(); iter != backEnd(); ++iter) {
+        RenderWidget *widget = static_cast<RenderWidget*>(*iter);
+        if (visible) {
+            widget->DidBecomeSelected();
+        } else {
+            widget->WasHidden();
+        }
+    }
+    if (!visible && mReleaseHiddenSurfaces) {
+        releaseSurfaces();
+    }
+}
+
+void WindowImpl::setReleaseSurfacesWhenHidden(bool release) {
+    mReleaseHiddenSurfaces = release;
+    if (release && !mVisible) {
+        releaseSurfaces();
+    }
+}
+
+void WindowImpl::releaseSurfaces() {
+    waitForPaintWorkers();
+    if (!mCanvas) {
+        return;
+    }
+    mCanvas->release();
+    if (mPageCanvas) {
+        mPageCanvas->release();
+    }
+    clearWidgetCanvases();
+    // Damage against the released pixels; the restore repaints everything.
+    mDirtyRegion.clear();
+    mBatchDamage.clear();
+    mDemandDamage.clear();
+    mPaintDamage.clear();
+    if (mDamageFilter) {
+        mDamageFilter->reset();
+    }
+    // Recreated empty; they grow again with the canvas.
+    setOutputFormat(mOutputFormat);
+    setYuvFormat(mYuvFormat);
+    setTileSize(mTileSize);
+}
+
+void WindowImpl::setCanvasEnabled(bool enabled) {
+    waitForPaintWorkers();
+    if (enabled == (mCanvas != NULL)) {
+        return;
+    }
+    mDirtyRegion.clear();
+    mBatchDamage.clear();
+    if (mDamageFilter) {
+        mDamageFilter->reset();
+    }
+    if (!enabled) {
+        // Painting on demand stops with the canvas, so drop any request and
+        // let the renderer paint again below.
+        mDemandDamage.clear();
+        mFrameCallback = NULL;
+        mFrameWaitsForPaint = false;
+        mFrameTimer.Stop();
+        clearWidgetCanvases();
+        delete mOutput;
+        mOutput = NULL;
+        delete mYuv;
+        mYuv = NULL;
+        delete mCanvas;
+        mCanvas = NULL;
+        configureWidgetCompositing();
+        releaseHeldPaintAck();
+        return;
+    }
+    mCanvas = new Canvas;
+    mCanvas->setSizeQuantum(mResizePolicy.mSurfaceQuantum);
+    configureWidgetCompositing();
+    setOutputFormat(mOutputFormat);
+    setYuvFormat(mYuvFormat);
+    setTileSize(mTileSize);
+    // The canvas starts out empty, so ask for a complete frame to fill it.
+    requestFullRepaint();
+}
+
+void WindowImpl::requestFullRepaint() {
+    RenderViewHost* myhost = host();
+    if (myhost && view()) {
+        gfx::Rect bounds = view()->GetViewBounds();
+        myhost->Send(new ViewMsg_Repaint(myhost->routing_id(), bounds.size()));
+    }
+}
+
+const unsigned char *WindowImpl::getFrame(Rect &frameRect) const {
+    waitForPaintWorkers();
+    if (!mCanvas) {
+        frameRect = Rect();
+        return NULL;
+    }
+    frameRect = mCanvas->rect();
+    return mCanvas->data();
+}
+
+bool WindowImpl::getFrameRegion(const Rect &region, unsigned char *dest,
+                                size_t destStride) const {
+    waitForPaintWorkers();
+    if (!mCanvas) {
+        return false;
+    }
+    return mCanvas->copyTo(region, dest, destStride);
+}
+
+void WindowImpl::drainDirtyRegion(std::vector<Rect> &dirtyRects) {
+    waitForPaintWorkers();
+    mDirtyRegion.drain(dirtyRects);
+}
+
+void WindowImpl::setTileSize(int tileSize) {
+    waitForPaintWorkers();
+    mTileSize = tileSize > 0 ? tileSize : 0;
+    if (mTileSize && mCanvas) {
+        mTiles.reset(mCanvas->width(), mCanvas->height(), mTileSize);
+        mTiles.markAll();
+    } else {
+        mTiles.reset(0, 0, 1);
+    }
+}
+
+void WindowImpl::drainDirtyTiles(std::vector<DirtyTile> &dirtyTiles) {
+    waitForPaintWorkers();
+    dirtyTiles.clear();
+    if (!mTileSize || !mCanvas || !mCanvas->data()) {
+        return;
+    }
+    const unsigned char *frame = mCanvas->data();
+    size_t stride = mCanvas->stride();
+    size_t bytesPerPixel = Canvas::kBytesPerPixel;
+    if (mOutput && mOutput->data()) {
+        frame = mOutput->data();
+        stride = mOutput->stride();
+        bytesPerPixel = pixelFormatBytesPerPixel(mOutput->format());
+    }
+    for (size_t tile = mTiles.nextDirty(0);
+         tile < mTiles.tileCount();
+         tile = mTiles.nextDirty(tile + 1)) {
+        DirtyTile dirty;
+        dirty.mColumn = (int)(tile % mTiles.columns());
+        dirty.mRow = (int)(tile / mTiles.columns());
+        dirty.mRect = mTiles.tileRect(tile);
+        dirty.mData = frame + dirty.mRect.top() * stride +
+            dirty.mRect.left() * bytesPerPixel;
+        dirty.mStride = stride;
+        dirtyTiles.push_back(dirty);
+    }
+    mTiles.clear();
+}
+
+void WindowImpl::setDamageSuppression(bool enabled) {
+    waitForPaintWorkers();
+    if (enabled == (mDamageFilter != NULL)) {
+        return;
+    }
+    if (enabled) {
+        mDamageFilter = new DamageFilter;
+    } else {
+        delete mDamageFilter;
+        mDamageFilter = NULL;
+    }
+}
+
+void WindowImpl::setYuvFormat(YuvFormat format) {
+    waitForPaintWorkers();
+    mYuvFormat = format;
+    configurePaintDamage();
+    delete mYuv;
+    mYuv = NULL;
+    if (mCanvas && format != YUV_FORMAT_NONE) {
+        mYuv = new YuvSurface(format);
+        // Converts whatever the canvas already holds.
+        mYuv->update(*mCanvas, 0, NULL);
+    }
+}
+
+bool WindowImpl::drainYuvFrame(YuvFrame &frame,
+                               std::vector<int> &dirtyMacroblockRows) {
+    waitForPaintWorkers();
+    if (!mYuv) {
+        dirtyMacroblockRows.clear();
+        return false;
+    }
+    mYuv->getFrame(frame);
+    mYuv->drainDirtyRows(dirtyMacroblockRows);
+    return true;
+}
+
+void WindowImpl::setThumbnailScale(int scaleShift) {
+    waitForPaintWorkers();
+    if (scaleShift <= 0) {
+        setThumbnailer(NULL);
+        return;
+    }
+    Thumbnailer *thumbnailer = mThumbnailer ? mThumbnailer : new Thumbnailer;
+    thumbnailer->setScaleShift(scaleShift);
+    setThumbnailer(thumbnailer);
+}
+
+void WindowImpl::setThumbnailSize(int maxWidth, int maxHeight) {
+    waitForPaintWorkers();
+    if (maxWidth <= 0) {
+        setThumbnailer(NULL);
+        return;
+    }
+    Thumbnailer *thumbnailer = mThumbnailer ? mThumbnailer : new Thumbnailer;
+    thumbnailer->setMaxSize(maxWidth, maxHeight);
+    setThumbnailer(thumbnailer);
+}
+
+void WindowImpl::setThumbnailer(Thumbnailer *thumbnailer) {
+    if (thumbnailer != mThumbnailer) {
+        delete mThumbnailer;
+        mThumbnailer = thumbnailer;
+    }
+    if (mThumbnailer && mCanvas) {
+        // Rebuilds from the current canvas if the scale changed.
+        mThumbnailer->update(*mCanvas, 0, NULL);
+        deliverThumbnail();
+    }
+}
+
+void WindowImpl::deliverThumbnail() {
+    if (!mThumbnailer || mThumbnailer->damage().empty()) {
+        return;
+    }
+    const DirtyRegion &thumbDamage = mThumbnailer->damage();
+    if (mDelegate) {
+        mDelegate->onThumbnailPaint(
+            this, mThumbnailer->data(*mCanvas), mThumbnailer->rect(),
+            thumbDamage.size(), thumbDamage.rects());
+    }
+    mThumbnailer->clearDamage();
+}
+
+void WindowImpl::setOutputFormat(PixelFormat format) {
+    waitForPaintWorkers();
+    mOutputFormat = format;
+    configurePaintDamage();
+    delete mOutput;
+    mOutput = NULL;
+    if (mCanvas && format != PIXEL_FORMAT_BGRA) {
+        mOutput = new OutputSurface(format);
+        mOutput->setSizeQuantum(mResizePolicy.mSurfaceQuantum);
+        // Converts whatever the canvas already holds.
+        mOutput->update(*mCanvas, 0, NULL);
+    }
+}
+
+void WindowImpl::setMaxFrameRate(double framesPerSecond) {
+    if (framesPerSecond > 0) {
+        mMinFrameInterval = base::TimeDelta::FromMicroseconds(
+            static_cast<int64>(1000000.0 / framesPerSecond));
+    } else {
+        mMinFrameInterval = base::TimeDelta();
+    }
+}
+
+void WindowImpl::setPaintOnDemand(bool enabled) {
+    waitForPaintWorkers();
+    mPaintOnDemand = enabled;
+    mDemandDamage.clear();
+    if (!enabled) {
+        mFrameCallback = NULL;
+        mFrameWaitsForPaint = false;
+        mFrameTimer.Stop();
+        releaseHeldPaintAck();
+    }
+}
+
+void WindowImpl::requestFrame(FrameCallback *callback, bool fullRepaint) {
+    if (!mPaintOnDemand || !mCanvas || mLeasedFrames) {
+        return;
+    }
+    mFrameCallback = callback;
+    mFrameWaitsForPaint = fullRepaint;
+    mFrameTimer.Stop();
+    if (fullRepaint) {
+        // The repaint should reach the callback as damage even where the
+        // page looks the same.
+        if (mDamageFilter) {
+            waitForPaintWorkers();
+            mDamageFilter->reset();
+        }
+        requestFullRepaint();
+    } else {
+        mFrameTimer.Start(base::TimeDelta(), this,
+                          &WindowImpl::deliverRequestedFrame);
+    }
+    releaseHeldPaintAck();
+}
+
+void WindowImpl::releaseHeldPaintAck() {
+    RenderViewHost* myhost = host();
+    if (myhost) {
+        static_cast<MemoryRenderViewHost*>(myhost)->Memory_ReleaseHeldAck();
+    }
+}
+
+void WindowImpl::deliverRequestedFrame() {
+    if (!mFrameCallback) {
+        return;
+    }
+    // Paints finished by workers only reach mDemandDamage once delivered.
+    PaintWorkerPool *workers = Root::getSingleton().getPaintWorkers();
+    if (workers) {
+        workers->finishPending();
+    }
+    FrameCallback *callback = mFrameCallback;
+    mFrameCallback = NULL;
+    mFrameWaitsForPaint = false;
+    mFrameTimer.Stop();
+    // The callback may destroy this Window, so nothing is kept in it.
+    std::vector<Rect> dirtyRects(mDemandDamage.rects(),
+                                 mDemandDamage.rects() + mDemandDamage.size());
+    mDemandDamage.clear();
+    FrameUpdate frame;
+    frame.mWindow = this;
+    frame.mWidget = NULL;
+    frame.mData = NULL;
+    frame.mStride = 0;
+    frame.mFormat = mOutputFormat;
+    frame.mRect = Rect();
+    if (mCanvas) {
+        frame.mData = mOutput ? mOutput->data() : mCanvas->data();
+        frame.mStride = mOutput ? mOutput->stride() : mCanvas->stride();
+        frame.mRect = mCanvas->rect();
+    }
+    frame.mNumDirtyRects = dirtyRects.size();
+    frame.mDirtyRects = dirtyRects.empty() ? NULL : &dirtyRects[0];
+    paintPresented();
+    callback->onFrame(this, frame);
+}
+
+void WindowImpl::setDeltaEncoder(DeltaEncoder *encoder) {
+    waitForPaintWorkers();
+    mDeltaEncoder = encoder;
+}
+
+void WindowImpl::setFrameExchange(FrameExchange *exchange) {
+    waitForPaintWorkers();
+    mFrameExchange = exchange;
+    if (mFrameExchange && mCanvas && mCanvas->data()) {
+        Rect whole = mCanvas->rect().translate(-mCanvas->rect().left(),
+                                               -mCanvas->rect().top());
+        mFrameExchange->publish(
+            mOutput ? mOutput->data() : mCanvas->data(),
+            mOutput ? mOutput->stride() : mCanvas->stride(),
+            mOutputFormat, mCanvas->rect(), 1, &whole);
+    }
+}
+
+void WindowImpl::setCoalescePolicy(const CoalescePolicy &policy) {
+    waitForPaintWorkers();
+    mCoalescePolicy = policy;
+    configurePaintDamage();
+}
+
+void WindowImpl::configurePaintDamage() {
+    size_t maxRects = mCoalescePolicy.mMaxRects ?
+        mCoalescePolicy.mMaxRects : DirtyRegion::kUnlimitedRects;
+    switch (mCoalescePolicy.mStrategy) {
+      case CoalescePolicy::COALESCE_NONE:
+        mPaintDamage.setMergePolicy(DirtyRegion::kUnlimitedRects, -1);
+        break;
+      case CoalescePolicy::COALESCE_MIN_BYTES:
+        mPaintDamage.setMergePolicy(maxRects, -1);
+        break;
+      case CoalescePolicy::COALESCE_MIN_CALLS:
+        mPaintDamage.setMergePolicy(1, -1);
+        break;
+      case CoalescePolicy::COALESCE_COST_MODEL: {
+        // Each damaged pixel is copied once in the output format, and once
+        // more into the YUV surface at 12 bits per pixel if there is one.
+        double bytesPerPixel = pixelFormatBytesPerPixel(mOutputFormat);
+        if (mYuvFormat != YUV_FORMAT_NONE) {
+            bytesPerPixel += 1.5;
+        }
+        mPaintDamage.setMergePolicy(
+            maxRects,
+            (long long)(mCoalescePolicy.mCallOverheadBytes / bytesPerPixel));
+        break;
+      }
+    }
+}
+
+void WindowImpl::getPaintStats(PaintStats &stats) const {
+    waitForPaintWorkers();
+    stats = mPaintStats;
+    stats.mAllocationCount += mDirtyRegion.allocationCount() +
+        mPaintDamage.allocationCount() + mSourceDamage.allocationCount() +
+        mRawDamage.allocationCount();
+}
+
+void WindowImpl::getLatencyStats(LatencyStats &stats) const {
+    stats = mLatencyStats;
+}
+
+void WindowImpl::resetLatencyStats() {
+    mLatencyStats.clear();
+}
+
 void WindowImpl::focus() {
     FrontToBackIter iter = frontIter();
     if (iter != frontEnd()) {
@@ -233,6 +714,9 @@ void WindowImpl::textEvent(const wchar_t* evt, size_t evtLength) {
         (*iter)->textEvent(evt,evtLength);
     }
 }
+void WindowImpl::setBulkTextThreshold(size_t utf16Length) {
+    mBulkTextThreshold = utf16Length;
+}
 void WindowImpl::keyEvent(bool pressed, int mods, int vk_code, int scancode) {
     FrontToBackIter iter = frontIter();
     if (iter != frontEnd()) {
@@ -240,10 +724,112 @@ void WindowImpl::keyEvent(bool pressed, int mods, int vk_code, int scancode) {
     }
 }
 
+// Earlier of two InputEvent timestamps, where 0 means none was given.
+static double earliestTimestamp(double a, double b) {
+    if (a <= 0) {
+        return b;
+    }
+    return (b > 0 && b < a) ? b : a;
+}
+
+size_t WindowImpl::injectInput(const InputEvent *events, size_t numEvents) {
+    size_t sent = 0;
+    size_t i = 0;
+    while (i < numEvents) {
+        const InputEvent &evt = events[i];
+        ++i;
+        switch (evt.mType) {
+          case InputEvent::MOUSE_MOVED: {
+            // Only the final position of a run of moves matters.
+            const InputEvent *last = &evt;
+            mInputLatencyStart = evt.mTimestamp;
+            while (i < numEvents &&
+                   events[i].mType == InputEvent::MOUSE_MOVED) {
+                last = &events[i++];
+                mInputLatencyStart = earliestTimestamp(mInputLatencyStart,
+                                                       last->mTimestamp);
+            }
+            mInputTimestamp = last->mTimestamp;
+            mouseMoved(last->mX, last->mY);
+            break;
+          }
+          case InputEvent::MOUSE_WHEEL: {
+            // Nothing moves the pointer in between, so the scrolls add up.
+            int xScroll = evt.mX, yScroll = evt.mY;
+            mInputTimestamp = evt.mTimestamp;
+            mInputLatencyStart = evt.mTimestamp;
+            while (i < numEvents &&
+                   events[i].mType == InputEvent::MOUSE_WHEEL) {
+                xScroll += events[i].mX;
+                yScroll += events[i].mY;
+                mInputTimestamp = events[i].mTimestamp;
+                mInputLatencyStart = earliestTimestamp(mInputLatencyStart,
+                                                       mInputTimestamp);
+                ++i;
+            }
+            mouseWheel(xScroll, yScroll);
+            break;
+          }
+          case InputEvent::MOUSE_BUTTON:
+            mInputTimestamp = evt.mTimestamp;
+            mInputLatencyStart = evt.mTimestamp;
+            mouseButton(evt.mButton, evt.mDown);
+            break;
+          case InputEvent::KEY:
+            mInputTimestamp = evt.mTimestamp;
+            mInputLatencyStart = evt.mTimestamp;
+            keyEvent(evt.mDown, evt.mModifiers, evt.mVirtualKey,
+                     evt.mScancode);
+            break;
+          case InputEvent::TEXT:
+            mInputTimestamp = evt.mTimestamp;
+            mInputLatencyStart = evt.mTimestamp;
+            textEvent(evt.mText, evt.mTextLength);
+            break;
+        }
+        ++sent;
+    }
+    mInputTimestamp = 0;
+    mInputLatencyStart = 0;
+    return sent;
+}
+
 
 
 void WindowImpl::resize(int width, int height) {
-    SetContainerBounds(gfx::Rect(0, 0, width, height));
+    gfx::Rect bounds(0, 0, width, height);
+    if (!mResizePolicy.mDebounceMilliseconds) {
+        mResizeTimer.Stop();
+        SetContainerBounds(bounds);
+        return;
+    }
+    // Restarting the timer drops whichever size it was waiting to send.
+    mPendingBounds = bounds;
+    mResizeTimer.Start(
+        base::TimeDelta::FromMilliseconds(mResizePolicy.mDebounceMilliseconds),
+        this, &WindowImpl::applyPendingResize);
+}
+
+void WindowImpl::applyPendingResize() {
+    SetContainerBounds(mPendingBounds);
+}
+
+void WindowImpl::setResizePolicy(const ResizePolicy &policy) {
+    waitForPaintWorkers();
+    mResizePolicy = policy;
+    if (mCanvas) {
+        mCanvas->setSizeQuantum(policy.mSurfaceQuantum);
+    }
+    if (mOutput) {
+        mOutput->setSizeQuantum(policy.mSurfaceQuantum);
+    }
+    if (mPageCanvas) {
+        mPageCanvas->setSizeQuantum(policy.mSurfaceQuantum);
+    }
+    if (!policy.mDebounceMilliseconds && mResizeTimer.IsRunning()) {
+        mResizeTimer.Stop();
+        applyPendingResize();
+    }
 }
 
 void WindowImpl::cut() {
@@ -404,7 +990,40 @@ void WindowImpl::onPaint(Widget *wid,
                          const Rect &sourceBufferRect,
                          size_t numCopyRects,
                          const Rect *copyRects,
-                         int dx, int dy, const Rect &scrollRect) {
+                         int dx, int dy, const Rect &scrollRect,
+                         const gfx::Size &viewSize) {
+    ++mPaintStats.mPaintCount;
+    if (!wid && mDeltaEncoder) {
+        mDeltaEncoder->encodePaint(viewSize.width(), viewSize.height(),
+                                   sourceBuffer, sourceBufferRect,
+                                   numCopyRects, copyRects,
+                                   dx, dy, scrollRect);
+    }
+    if (wid && mPageCanvas) {
+        compositeWidgetPaint(wid, sourceBuffer, sourceBufferRect,
+                             numCopyRects, copyRects,
+                             dx, dy, scrollRect, viewSize);
+        return;
+    }
+    if (wid && mCanvas && Root::getSingleton().getFrameBatchDelegate()) {
+        paintWidgetCanvas(wid, sourceBuffer, sourceBufferRect,
+                          numCopyRects, copyRects,
+                          dx, dy, scrollRect, viewSize);
+        return;
+    }
+    if (!wid && mCanvas) {
+        pagePaintApplied(updateCanvas(sourceBuffer, sourceBufferRect,
+                                      numCopyRects, copyRects,
+                                      dx, dy, scrollRect, viewSize,
+                                      mPaintStats));
+        return;
+    }
+    if (mCoalescePolicy.mStrategy != CoalescePolicy::COALESCE_NONE) {
+        mSourceDamage.clear();
+        mSourceDamage.add(numCopyRects, copyRects);
+        numCopyRects = mSourceDamage.size();
+        copyRects = mSourceDamage.rects();
+    }
     if (mDelegate) {
         if (wid) {
             mDelegate->onWidgetPaint(
@@ -422,13 +1041,481 @@ void WindowImpl::onPaint(Widget *wid,
     }
 }
 
+bool WindowImpl::paintsOnWorker() const {
+    // Compositing reads widget canvases, which only the UI thread updates.
+    return mCanvas && !mLeasedFrames && !mPageCanvas &&
+        Root::getSingleton().getPaintWorkers();
+}
+
+bool WindowImpl::paintOnWorker(FrameLeaseImpl *lease,
+                               const gfx::Size &viewSize,
+                               PaintStats &stats) {
+    ++stats.mPaintCount;
+    if (mDeltaEncoder) {
+        mDeltaEncoder->encodePaint(viewSize.width(), viewSize.height(),
+                                   lease->getBuffer(), lease->getBufferRect(),
+                                   lease->getNumCopyRects(),
+                                   lease->getCopyRects(),
+                                   lease->getScrollX(), lease->getScrollY(),
+                                   lease->getScrollRect());
+    }
+    return updateCanvas(lease->getBuffer(), lease->getBufferRect(),
+                        lease->getNumCopyRects(), lease->getCopyRects(),
+                        lease->getScrollX(), lease->getScrollY(),
+                        lease->getScrollRect(), viewSize, stats);
+}
+
+void WindowImpl::waitForPaintWorkers() const {
+    PaintWorkerPool *workers = Root::getSingleton().getPaintWorkers();
+    if (workers) {
+        workers->waitForWorkers();
+    }
+}
+
+bool WindowImpl::updateCanvas(const unsigned char *sourceBuffer,
+                              const Rect &sourceBufferRect,
+                              size_t numCopyRects,
+                              const Rect *copyRects,
+                              int dx, int dy, const Rect &scrollRect,
+                              const gfx::Size &viewSize,
+                              PaintStats &stats) {
+    if (mCanvas->width() != viewSize.width() ||
+        mCanvas->height() != viewSize.height()) {
+        if (mCanvas->resize(viewSize.width(), viewSize.height())) {
+            ++stats.mAllocationCount;
+        }
+        if (mPageCanvas &&
+            mPageCanvas->resize(viewSize.width(), viewSize.height())) {
+            ++stats.mAllocationCount;
+        }
+        mDirtyRegion.clear();
+        if (mDamageFilter) {
+            mDamageFilter->reset();
+        }
+    }
+
+    // While compositing widgets, the page is kept apart so that what lies
+    // under a widget can be restored.
+    Canvas &page = mPageCanvas ? *mPageCanvas : *mCanvas;
+    DirtyRegion &damage = canvasDamage();
+    if (dx || dy) {
+        // Only the shifted pixels are damaged by the move itself; the
+        // renderer sends the exposed strip as copy rects.
+        damage.add(page.scroll(dx, dy, scrollRect));
+    }
+    page.blit(sourceBuffer, sourceBufferRect, numCopyRects, copyRects);
+    for (size_t i = 0; i < numCopyRects; ++i) {
+        damage.add(copyRects[i].intersect(page.rect()));
+    }
+    if (mPageCanvas) {
+        for (size_t i = 0; i < damage.size(); ++i) {
+            composeRect(damage.rects()[i]);
+        }
+    }
+    return finishCanvasDamage(stats);
+}
+
+DirtyRegion &WindowImpl::canvasDamage() {
+    // With suppression on, damage is collected unmerged so the filter sees
+    // the renderer's rects, and coalescing applies to what survives.
+    DirtyRegion &damage = mDamageFilter ? mRawDamage : mPaintDamage;
+    damage.clear();
+    return damage;
+}
+
+bool WindowImpl::finishCanvasDamage(PaintStats &stats) {
+    DirtyRegion &damage = mDamageFilter ? mRawDamage : mPaintDamage;
+    const size_t bytesPerPixel = mOutput ?
+        pixelFormatBytesPerPixel(mOutput->format()) : Canvas::kBytesPerPixel;
+    if (mDamageFilter) {
+        mPaintDamage.clear();
+        long long suppressed = mDamageFilter->filter(*mCanvas, damage,
+                                                     mPaintDamage);
+        stats.mSuppressedBytes += suppressed * bytesPerPixel;
+    }
+    // Even without damage, the converted copies must follow a resize of
+    // the canvas.
+    if (mOutput) {
+        if (mOutput->update(*mCanvas,
+                            mPaintDamage.size(), mPaintDamage.rects())) {
+            ++stats.mAllocationCount;
+        }
+    }
+    if (mYuv) {
+        if (mYuv->update(*mCanvas,
+                         mPaintDamage.size(), mPaintDamage.rects())) {
+            ++stats.mAllocationCount;
+        }
+    }
+    if (mPaintDamage.empty()) {
+        // A freshly built thumbnail still goes out with an unchanged page.
+        return mThumbnailer && !mThumbnailer->damage().empty();
+    }
+    for (size_t i = 0; i < mPaintDamage.size(); ++i) {
+        const Rect &r = mPaintDamage.rects()[i];
+        stats.mDeliveredBytes +=
+            (unsigned long long)r.width() * r.height() * bytesPerPixel;
+    }
+    mDirtyRegion.add(mPaintDamage.size(), mPaintDamage.rects());
+    if (mTileSize) {
+        if (mTiles.width() != mCanvas->width() ||
+            mTiles.height() != mCanvas->height()) {
+            mTiles.reset(mCanvas->width(), mCanvas->height(), mTileSize);
+            mTiles.markAll();
+        }
+        for (size_t i = 0; i < mPaintDamage.size(); ++i) {
+            mTiles.markRect(mPaintDamage.rects()[i]);
+        }
+    }
+
+    if (mThumbnailer) {
+        mThumbnailer->update(*mCanvas,
+                             mPaintDamage.size(), mPaintDamage.rects());
+    }
+    if (mOpaqueDetection) {
+        mOpaqueRects.clear();
+        for (size_t i = 0; i < mPaintDamage.size(); ++i) {
+            findOpaqueRows(mCanvas->data(), mCanvas->stride(),
+                           mPaintDamage.rects()[i], mOpaqueRects);
+        }
+    }
+    return true;
+}
+
+void WindowImpl::deliverCanvasPaint() {
+    if (!mCanvas) {
+        return;
+    }
+    deliverThumbnail();
+    if (mPaintDamage.empty()) {
+        return;
+    }
+    if (mFrameExchange) {
+        mFrameExchange->publish(
+            mOutput ? mOutput->data() : mCanvas->data(),
+            mOutput ? mOutput->stride() : mCanvas->stride(),
+            mOutputFormat, mCanvas->rect(),
+            mPaintDamage.size(), mPaintDamage.rects());
+    }
+    if (mPaintOnDemand) {
+        // Presented when deliverRequestedFrame hands it out.
+        mDemandDamage.add(mPaintDamage.size(), mPaintDamage.rects());
+        if (mFrameCallback && mFrameWaitsForPaint) {
+            deliverRequestedFrame();
+        }
+        return;
+    }
+    if (mOpaqueDetection && mDelegate) {
+        mDelegate->onOpaqueRects(
+            this, mOpaqueRects.size(),
+            mOpaqueRects.empty() ? NULL : &mOpaqueRects[0]);
+    }
+    if (Root::getSingleton().getFrameBatchDelegate()) {
+        mBatchDamage.add(mPaintDamage.size(), mPaintDamage.rects());
+        queueFrameBatch();
+        paintPresented();
+        return;
+    }
+    const unsigned char *frame = mOutput ? mOutput->data() : mCanvas->data();
+    if (mDelegate) {
+        Rect noScroll = Rect();
+        mDelegate->onPaint(
+            this,
+            frame, mCanvas->rect(),
+            mPaintDamage.size(), mPaintDamage.rects(),
+            0, 0, noScroll);
+    }
+    paintPresented();
+}
+
+void WindowImpl::pagePaintApplied(bool changed) {
+    // A request waiting for a repaint is answered by it even if all of its
+    // damage was suppressed, which deliverCanvasPaint would skip.
+    bool answersRequest = mPaintOnDemand && mFrameCallback &&
+        mFrameWaitsForPaint && mPaintDamage.empty();
+    if (changed) {
+        deliverCanvasPaint();
+    }
+    if (answersRequest) {
+        deliverRequestedFrame();
+    }
+}
+
+void WindowImpl::paintPresented() {
+    // Paints from a worker are only presented here, not in the host.
+    RenderWidget *widget = static_cast<RenderWidget*>(view());
+    if (widget) {
+        widget->paintPresented();
+    }
+}
+
+void WindowImpl::paintWidgetCanvas(Widget *wid,
+                                   const unsigned char *sourceBuffer,
+                                   const Rect &sourceBufferRect,
+                                   size_t numCopyRects,
+                                   const Rect *copyRects,
+                                   int dx, int dy, const Rect &scrollRect,
+                                   const gfx::Size &viewSize) {
+    WidgetCanvas *entry = updateWidgetCanvas(wid, sourceBuffer,
+                                             sourceBufferRect,
+                                             numCopyRects, copyRects,
+                                             dx, dy, scrollRect, viewSize);
+    if (!entry->mDamage.empty()) {
+        queueFrameBatch();
+    }
+}
+
+void WindowImpl::compositeWidgetPaint(Widget *wid,
+                                      const unsigned char *sourceBuffer,
+                                      const Rect &sourceBufferRect,
+                                      size_t numCopyRects,
+                                      const Rect *copyRects,
+                                      int dx, int dy, const Rect &scrollRect,
+                                      const gfx::Size &viewSize) {
+    WidgetCanvas *entry = updateWidgetCanvas(wid, sourceBuffer,
+                                             sourceBufferRect,
+                                             numCopyRects, copyRects,
+                                             dx, dy, scrollRect, viewSize);
+    Rect area = entry->mCanvas.rect();
+    Rect widgetRect = wid->getRect();
+    area.mLeft = widgetRect.left();
+    area.mTop = widgetRect.top();
+    DirtyRegion &damage = canvasDamage();
+    const Rect &old = entry->mComposited;
+    if (area.left() != old.left() || area.top() != old.top() ||
+        area.width() != old.width() || area.height() != old.height()) {
+        // Moved or resized: uncover the old area and draw all of the new.
+        damage.add(old.intersect(mCanvas->rect()));
+        damage.add(area.intersect(mCanvas->rect()));
+        entry->mComposited = area;
+    } else {
+        for (size_t i = 0; i < entry->mDamage.size(); ++i) {
+            damage.add(entry->mDamage.rects()[i]
+                       .translate(area.left(), area.top())
+                       .intersect(mCanvas->rect()));
+        }
+    }
+    entry->mDamage.clear();
+    for (size_t i = 0; i < damage.size(); ++i) {
+        composeRect(damage.rects()[i]);
+    }
+    if (finishCanvasDamage(mPaintStats)) {
+        deliverCanvasPaint();
+    }
+}
+
+WindowImpl::WidgetCanvas *WindowImpl::findWidgetCanvas(Widget *wid) const {
+    for (size_t i = 0; i < mWidgetCanvases.size(); ++i) {
+        if (mWidgetCanvases[i]->mWidget == wid) {
+            return mWidgetCanvases[i];
+        }
+    }
+    return NULL;
+}
+
+WindowImpl::WidgetCanvas *WindowImpl::updateWidgetCanvas(
+        Widget *wid,
+        const unsigned char *sourceBuffer,
+        const Rect &sourceBufferRect,
+        size_t numCopyRects,
+        const Rect *copyRects,
+        int dx, int dy, const Rect &scrollRect,
+        const gfx::Size &viewSize) {
+    WidgetCanvas *entry = findWidgetCanvas(wid);
+    if (!entry) {
+        entry = new WidgetCanvas;
+        entry->mWidget = wid;
+        entry->mComposited = Rect();
+        entry->mCanvas.setSizeQuantum(mResizePolicy.mSurfaceQuantum);
+        mWidgetCanvases.push_back(entry);
+    }
+    Canvas &canvas = entry->mCanvas;
+    if (canvas.width() != viewSize.width() ||
+        canvas.height() != viewSize.height()) {
+        if (canvas.resize(viewSize.width(), viewSize.height())) {
+            ++mPaintStats.mAllocationCount;
+        }
+        entry->mDamage.clear();
+    }
+    if (dx || dy) {
+        entry->mDamage.add(canvas.scroll(dx, dy, scrollRect));
+    }
+    canvas.blit(sourceBuffer, sourceBufferRect, numCopyRects, copyRects);
+    for (size_t i = 0; i < numCopyRects; ++i) {
+        entry->mDamage.add(copyRects[i].intersect(canvas.rect()));
+    }
+    return entry;
+}
+
+void WindowImpl::composeRect(const Rect &rect) {
+    const Rect r = rect.intersect(mCanvas->rect());
+    if (r.isEmpty()) {
+        return;
+    }
+    const size_t stride = mCanvas->stride();
+    unsigned char *dest = mCanvas->data() +
+        r.top() * stride + r.left() * Canvas::kBytesPerPixel;
+    mPageCanvas->copyTo(r, dest, stride);
+    // Widgets are opaque, so later ones simply overwrite earlier ones.
+    for (BackToFrontIter iter = backIter(); iter != backEnd(); ++iter) {
+        WidgetCanvas *entry = findWidgetCanvas(*iter);
+        if (!entry) {
+            continue;
+        }
+        const Rect &area = entry->mComposited;
+        Rect overlap = r.intersect(area);
+        if (overlap.isEmpty()) {
+            continue;
+        }
+        entry->mCanvas.copyTo(
+            overlap.translate(-area.left(), -area.top()),
+            mCanvas->data() + overlap.top() * stride +
+                overlap.left() * Canvas::kBytesPerPixel,
+            stride);
+    }
+}
+
+void WindowImpl::setWidgetCompositing(bool enabled) {
+    waitForPaintWorkers();
+    mWidgetCompositing = enabled;
+    if (!configureWidgetCompositing()) {
+        return;
+    }
+    // Nothing is composited yet, or widgets are baked into the canvas, so
+    // everything has to be painted again.
+    requestFullRepaint();
+    for (BackToFrontIter iter = backIter(); iter != backEnd(); ++iter) {
+        if (*iter == getWidget()) {
+            continue;
+        }
+        RenderWidget *widget = static_cast<RenderWidget*>(*iter);
+        RenderWidgetHost *widgetHost = widget->GetRenderWidgetHost();
+        Rect rect = widget->getRect();
+        widgetHost->Send(new ViewMsg_Repaint(
+            widgetHost->routing_id(),
+            gfx::Size(rect.width(), rect.height())));
+    }
+}
+
+bool WindowImpl::configureWidgetCompositing() {
+    const bool compositing = mWidgetCompositing && mCanvas;
+    if (compositing == (mPageCanvas != NULL)) {
+        return false;
+    }
+    // Widget canvases only hold what the previous mode needed.
+    clearWidgetCanvases();
+    if (compositing) {
+        mPageCanvas = new Canvas;
+        mPageCanvas->setSizeQuantum(mResizePolicy.mSurfaceQuantum);
+        mPageCanvas->resize(mCanvas->width(), mCanvas->height());
+    } else {
+        delete mPageCanvas;
+        mPageCanvas = NULL;
+    }
+    return mCanvas != NULL;
+}
+
+void WindowImpl::queueFrameBatch() {
+    if (!mFrameBatchQueued) {
+        mFrameBatchQueued = true;
+        Root::getSingleton().queueFrameBatch(this);
+    }
+}
+
+void WindowImpl::clearWidgetCanvases() {
+    for (size_t i = 0; i < mWidgetCanvases.size(); ++i) {
+        delete mWidgetCanvases[i];
+    }
+    mWidgetCanvases.clear();
+}
+
+void WindowImpl::takeFrameUpdates(std::vector<FrameUpdate> &updates,
+                                  std::vector<Rect> &dirtyRects) {
+    mFrameBatchQueued = false;
+    if (!mCanvas) {
+        return;
+    }
+    if (!mBatchDamage.empty()) {
+        FrameUpdate update;
+        update.mWindow = this;
+        update.mWidget = NULL;
+        update.mData = mOutput ? mOutput->data() : mCanvas->data();
+        update.mStride = mOutput ? mOutput->stride() : mCanvas->stride();
+        update.mFormat = mOutputFormat;
+        update.mRect = mCanvas->rect();
+        update.mNumDirtyRects = mBatchDamage.size();
+        update.mDirtyRects = NULL;
+        updates.push_back(update);
+        dirtyRects.insert(dirtyRects.end(), mBatchDamage.rects(),
+                          mBatchDamage.rects() + mBatchDamage.size());
+        mBatchDamage.clear();
+    }
+    for (size_t i = 0; i < mWidgetCanvases.size(); ++i) {
+        WidgetCanvas *entry = mWidgetCanvases[i];
+        if (entry->mDamage.empty()) {
+            continue;
+        }
+        FrameUpdate update;
+        update.mWindow = this;
+        update.mWidget = entry->mWidget;
+        update.mData = entry->mCanvas.data();
+        update.mStride = entry->mCanvas.stride();
+        update.mFormat = PIXEL_FORMAT_BGRA;
+        update.mRect = entry->mCanvas.rect();
+        Rect widgetRect = entry->mWidget->getRect();
+        update.mRect.mLeft = widgetRect.left();
+        update.mRect.mTop = widgetRect.top();
+        update.mNumDirtyRects = entry->mDamage.size();
+        update.mDirtyRects = NULL;
+        updates.push_back(update);
+        dirtyRects.insert(dirtyRects.end(), entry->mDamage.rects(),
+                          entry->mDamage.rects() + entry->mDamage.size());
+        entry->mDamage.clear();
+    }
+}
+
+void WindowImpl::onLeasedPaint(Widget *wid, FrameLease *lease) {
+    ++mPaintStats.mPaintCount;
+    if (mDelegate) {
+        mDelegate->onLeasedPaint(this, wid, lease);
+    }
+}
+
+Rect *WindowImpl::paintRectArena(size_t count) {
+    if (count > mPaintRectArena.capacity()) {
+        ++mPaintStats.mAllocationCount;
+    }
+    mPaintRectArena.resize(count);
+    return count ? &mPaintRectArena[0] : NULL;
+}
+
 void WindowImpl::onWidgetDestroyed(Widget *wid) {
+    Rect uncovered = Rect();
+    for (size_t i = 0; i < mWidgetCanvases.size(); ++i) {
+        if (mWidgetCanvases[i]->mWidget == wid) {
+            uncovered = mWidgetCanvases[i]->mComposited;
+            delete mWidgetCanvases[i];
+            mWidgetCanvases.erase(mWidgetCanvases.begin() + i);
+            break;
+        }
+    }
     if (wid != getWidget()) {
         if (mDelegate) {
             mDelegate->onWidgetDestroyed(this, wid);
         }
     }
     removeWidget(wid);
+    if (mPageCanvas && mCanvas) {
+        // Show the page again where the widget used to be.
+        DirtyRegion &damage = canvasDamage();
+        damage.add(uncovered.intersect(mCanvas->rect()));
+        if (!damage.empty()) {
+            composeRect(damage.rects()[0]);
+            if (finishCanvasDamage(mPaintStats)) {
+                deliverCanvasPaint();
+            }
+        }
+    }
 }
 
 /******* RenderViewHostManager::Delegate *******/
@@ -453,6 +1540,10 @@ bool WindowImpl::CreateRenderViewForRenderManager(
   render_view_host->set_view(rwh_view);
 
   appendWidget(rwh_view);
+  // setVisible(false) may have come before there was a view to hide.
+  if (!mVisible) {
+      rwh_view->WasHidden();
+  }
 
 //  UpdateMaxPageIDIfNecessary(render_view_host->site_instance(),
 //                             render_view_host);
@@ -1094,6 +2185,9 @@ void WindowImpl::ShowCreatedWidget(int route_id,
 
     wid->InitAsPopup(view(), initial_pos);
     wid->GetRenderWidgetHost()->Init();
+    if (!mVisible) {
+        wid->WasHidden();
+    }
 
     wid->SetSize(gfx::Size(initial_pos.width(), initial_pos.height()));
     wid->setPos(initial_pos.x(), initial_pos.y());
@@ -35,6 +35,20 @@
 #include "berkelium/Widget.hpp"
 #include "berkelium/Window.hpp"
 #include "NavigationController.hpp"
+#include "Canvas.hpp"
+#include "DirtyRegion.hpp"
+#include "DamageFilter.hpp"
+#include "OutputSurface.hpp"
+#include "YuvSurface.hpp"
+#include "TileGrid.hpp"
+#include "Thumbnailer.hpp"
+#include "berkelium/PaintStats.hpp"
+#include "berkelium/LatencyStats.hpp"
+#include "berkelium/CoalescePolicy.hpp"
+#include "berkelium/ResizePolicy.hpp"
+#include "berkelium/FrameBatch.hpp"
+#include "base/time.h"
+#include "base/timer.h"
 #include "gfx/rect.h"
 #include "gfx/size.h"
 #include "chrome/browser/renderer_host/render_widget_host.h"
@@ -50,6 +64,8 @@ namespace Berkelium {
 class WindowView;
 class RenderWidget;
 class MemoryRenderViewHost;
+class FrameLease;
+class FrameLeaseImpl;
 struct Rect;
 class NavigationController;
 
@@ -110,6 +126,64 @@ public:
     virtual Widget* getWidget() const;
 
     virtual void setTransparent(bool istrans);
+    virtual void setWidgetCompositing(bool enabled);
+    virtual void setOpaqueDetection(bool enabled);
+    virtual void setLeasedFrames(bool leased);
+    virtual void setVisible(bool visible);
+    virtual void setReleaseSurfacesWhenHidden(bool release);
+    bool usesLeasedFrames() const {
+        return mLeasedFrames;
+    }
+    virtual void setCanvasEnabled(bool enabled);
+    virtual const unsigned char *getFrame(Rect &frameRect) const;
+    virtual bool getFrameRegion(const Rect &region, unsigned char *dest,
+                                size_t destStride) const;
+    virtual void drainDirtyRegion(std::vector<Rect> &dirtyRects);
+    virtual void setTileSize(int tileSize);
+    virtual void drainDirtyTiles(std::vector<DirtyTile> &dirtyTiles);
+    virtual void setDamageSuppression(bool enabled);
+    virtual void setYuvFormat(YuvFormat format);
+    virtual bool drainYuvFrame(YuvFrame &frame,
+                               std::vector<int> &dirtyMacroblockRows);
+    virtual void setThumbnailScale(int scaleShift);
+    virtual void setThumbnailSize(int maxWidth, int maxHeight);
+    virtual void setOutputFormat(PixelFormat format);
+    virtual void setMaxFrameRate(double framesPerSecond);
+    virtual void setDeltaEncoder(DeltaEncoder *encoder);
+    virtual void setFrameExchange(FrameExchange *exchange);
+    base::TimeDelta getMinFrameInterval() const {
+        return mMinFrameInterval;
+    }
+    virtual void setPaintOnDemand(bool enabled);
+    virtual void requestFrame(FrameCallback *callback, bool fullRepaint);
+    // True while painting on demand with no frame requested, so the host
+    // should not let the renderer paint again yet. Leased paints bypass the
+    // canvas, so their release alone drives the ACK.
+    bool holdsPaintAck() const {
+        return presentsOnRequest() && !mFrameCallback;
+    }
+    // True if page paints only reach the application through requestFrame.
+    bool presentsOnRequest() const {
+        return mPaintOnDemand && mCanvas && !mLeasedFrames;
+    }
+    // True if page paints go into the canvas, whose delivery then records
+    // their presentation.
+    bool paintsCanvas() const {
+        return mCanvas && !mLeasedFrames;
+    }
+    virtual void setCoalescePolicy(const CoalescePolicy &policy);
+    virtual void getPaintStats(PaintStats &stats) const;
+    virtual void getLatencyStats(LatencyStats &stats) const;
+    virtual void resetLatencyStats();
+    // Where the render hosts of this Window count their allocations. UI
+    // thread only.
+    PaintStats &paintStats() {
+        return mPaintStats;
+    }
+    // Where the RenderWidgets of this Window record input latency.
+    LatencyStats &latencyStats() {
+        return mLatencyStats;
+    }
 
     virtual int getId() const;
 
@@ -119,7 +193,22 @@ public:
     virtual void mouseButton(unsigned int buttonID, bool down);
     virtual void mouseWheel(int xScroll, int yScroll);
     virtual void textEvent(const wchar_t *evt, size_t evtLength);
+    virtual void setBulkTextThreshold(size_t utf16Length);
+    size_t getBulkTextThreshold() const {
+        return mBulkTextThreshold;
+    }
+    // Timestamp of the event injectInput is sending, or 0 to stamp events
+    // with the current time.
+    double getInputTimestamp() const {
+        return mInputTimestamp;
+    }
+    // Time to measure the latency of that event from: the earliest given
+    // timestamp of the events coalesced into it, or 0 if none was given.
+    double getInputLatencyStart() const {
+        return mInputLatencyStart;
+    }
     virtual void keyEvent(bool pressed, int mods, int vk_code, int scancode);
+    virtual size_t injectInput(const InputEvent *events, size_t numEvents);
 
     virtual void adjustZoom (int mode);
 
@@ -146,12 +235,37 @@ public:
 
     void SetContainerBounds(const gfx::Rect &rc);
     void resize(int width, int height);
+    virtual void setResizePolicy(const ResizePolicy &policy);
 
     void onPaint(Widget *wid,
                  const unsigned char *sourceBuffer,
                  const Rect &sourceBufferRect,
                  size_t numCopyRects, const Rect *copyRects,
-                 int dx, int dy, const Rect &scrollRect);
+                 int dx, int dy, const Rect &scrollRect,
+                 const gfx::Size &viewSize);
+    void onLeasedPaint(Widget *wid, FrameLease *lease);
+    // True if main view paints should go through the paint worker pool.
+    bool paintsOnWorker() const;
+    // Runs on a paint worker: applies the leased paint to the canvas,
+    // counting into |stats| rather than mPaintStats, which the UI thread
+    // may be updating. Returns false if nothing visible changed; the UI
+    // thread passes the result to pagePaintApplied().
+    bool paintOnWorker(FrameLeaseImpl *lease, const gfx::Size &viewSize,
+                       PaintStats &stats);
+    // Notifies the delegate of the last canvas update, or queues it for the
+    // frame batch.
+    void deliverCanvasPaint();
+    // Called once a page paint has been applied to the canvas, with what
+    // updateCanvas or paintOnWorker returned.
+    void pagePaintApplied(bool changed);
+    // Appends the canvases changed since the last batch to |updates|, and
+    // their dirty rects to |dirtyRects|. mDirtyRects is left NULL for the
+    // caller to point into |dirtyRects| once it stops growing.
+    void takeFrameUpdates(std::vector<FrameUpdate> &updates,
+                          std::vector<Rect> &dirtyRects);
+    // Returns room for count rects, reused between paints of this Window.
+    // Valid until the next call.
+    Rect *paintRectArena(size_t count);
     void onWidgetDestroyed(Widget *wid);
 
     // Called from MemoryRenderViewHost, since RenderViewHost does nothing here?!
@@ -168,6 +282,83 @@ public:
 protected:
     ContextImpl *getContextImpl() const;
 
+    // Configures mPaintDamage from mCoalescePolicy.
+    void configurePaintDamage();
+    // Sends the size held back by the resize debounce.
+    void applyPendingResize();
+    // Records input latency for the canvas paint just handed on.
+    void paintPresented();
+    // Hands the canvas and mDemandDamage to mFrameCallback.
+    void deliverRequestedFrame();
+    // Lets the renderer paint again after holdsPaintAck() stopped it.
+    void releaseHeldPaintAck();
+
+    // Returns the damage list updateCanvas fills, emptied.
+    DirtyRegion &canvasDamage();
+    // Filters, records and converts the damage in canvasDamage(). Returns
+    // false if none of it is left to deliver.
+    bool finishCanvasDamage(PaintStats &stats);
+    // Applies a paint to mCanvas and the output surface. Returns false if
+    // nothing visible changed. May run on a paint worker thread, so work
+    // is counted into |stats|.
+    bool updateCanvas(const unsigned char *sourceBuffer,
+                      const Rect &sourceBufferRect,
+                      size_t numCopyRects, const Rect *copyRects,
+                      int dx, int dy, const Rect &scrollRect,
+                      const gfx::Size &viewSize,
+                      PaintStats &stats);
+
+    // Blocks until no paint worker is touching the canvas.
+    void waitForPaintWorkers() const;
+
+    // Copies a widget paint into that widget's canvas for the frame batch.
+    void paintWidgetCanvas(Widget *wid,
+                           const unsigned char *sourceBuffer,
+                           const Rect &sourceBufferRect,
+                           size_t numCopyRects, const Rect *copyRects,
+                           int dx, int dy, const Rect &scrollRect,
+                           const gfx::Size &viewSize);
+    // Copies a widget paint into that widget's canvas and composites it
+    // into the page canvas.
+    void compositeWidgetPaint(Widget *wid,
+                              const unsigned char *sourceBuffer,
+                              const Rect &sourceBufferRect,
+                              size_t numCopyRects, const Rect *copyRects,
+                              int dx, int dy, const Rect &scrollRect,
+                              const gfx::Size &viewSize);
+    struct WidgetCanvas {
+        Widget *mWidget;
+        Canvas mCanvas;
+        DirtyRegion mDamage;
+        // Area of the page the widget was last composited over.
+        Rect mComposited;
+    };
+    WidgetCanvas *findWidgetCanvas(Widget *wid) const;
+    // Applies a widget paint to its canvas, creating it if needed, and
+    // adds the damage to the entry.
+    WidgetCanvas *updateWidgetCanvas(Widget *wid,
+                                     const unsigned char *sourceBuffer,
+                                     const Rect &sourceBufferRect,
+                                     size_t numCopyRects,
+                                     const Rect *copyRects,
+                                     int dx, int dy, const Rect &scrollRect,
+                                     const gfx::Size &viewSize);
+    // Rebuilds |rect| of mCanvas from mPageCanvas and the widgets on top.
+    void composeRect(const Rect &rect);
+    // Creates or drops mPageCanvas to match mWidgetCompositing. Returns
+    // true if the canvas needs to be repainted.
+    bool configureWidgetCompositing();
+    void queueFrameBatch();
+    void setThumbnailer(Thumbnailer *thumbnailer);
+    // Passes thumbnail damage, if any, to onThumbnailPaint.
+    void deliverThumbnail();
+    // Asks the renderer to repaint the whole view.
+    void requestFullRepaint();
+    // Frees the canvas memory while hidden; it is rebuilt by the repaint
+    // that follows setVisible(true).
+    void releaseSurfaces();
+    void clearWidgetCanvases();
+
     bool CreateRenderViewForRenderManager(
         RenderViewHost* render_view_host,
         bool remote_view_exists);
@@ -350,6 +541,81 @@ private:
     bool received_page_title_;
     bool is_loading_;
     bool is_crashed_;
+    bool mLeasedFrames;
+    bool mVisible;
+    bool mReleaseHiddenSurfaces;
+    // Zero if the frame rate is not capped, see setMaxFrameRate.
+    base::TimeDelta mMinFrameInterval;
+    // Text at least this long goes to the renderer as one IME commit.
+    size_t mBulkTextThreshold;
+    double mInputTimestamp;
+    double mInputLatencyStart;
+    ResizePolicy mResizePolicy;
+    // Size waiting out mResizePolicy's debounce while mResizeTimer runs.
+    gfx::Rect mPendingBounds;
+    base::OneShotTimer<WindowImpl> mResizeTimer;
+    // See setPaintOnDemand. mDemandDamage collects paints not yet handed to
+    // a FrameCallback; mFrameTimer delivers requests that do not wait for a
+    // repaint.
+    bool mPaintOnDemand;
+    DirtyRegion mDemandDamage;
+    FrameCallback *mFrameCallback;
+    bool mFrameWaitsForPaint;
+    base::OneShotTimer<WindowImpl> mFrameTimer;
+    // Application-owned encoder fed from every page paint, or NULL.
+    DeltaEncoder *mDeltaEncoder;
+    // Application-owned exchange fed from every canvas paint, or NULL.
+    FrameExchange *mFrameExchange;
+
+    // Library-side copy of the page, see setCanvasEnabled. NULL if disabled.
+    Canvas *mCanvas;
+    // The canvas converted to mOutputFormat, or NULL while that is BGRA or
+    // the canvas is disabled.
+    PixelFormat mOutputFormat;
+    OutputSurface *mOutput;
+    // YUV copy of the canvas for encoders; NULL while mYuvFormat is
+    // YUV_FORMAT_NONE or the canvas is disabled.
+    YuvFormat mYuvFormat;
+    YuvSurface *mYuv;
+    // Dirty tiles since the last drainDirtyTiles; unused while mTileSize
+    // is 0.
+    int mTileSize;
+    TileGrid mTiles;
+    // Damage since the application last called drainDirtyRegion.
+    DirtyRegion mDirtyRegion;
+    // Damage of the paint currently being delivered, coalesced according
+    // to mCoalescePolicy.
+    DirtyRegion mPaintDamage;
+    CoalescePolicy mCoalescePolicy;
+    // Drops damage whose pixels did not change; NULL unless enabled with
+    // setDamageSuppression. mRawDamage holds its input.
+    DamageFilter *mDamageFilter;
+    DirtyRegion mRawDamage;
+    // Downscaled copy of the canvas; NULL unless a thumbnail was requested.
+    Thumbnailer *mThumbnailer;
+    // Page without widgets while they are composited into mCanvas, see
+    // setWidgetCompositing; NULL otherwise.
+    bool mWidgetCompositing;
+    Canvas *mPageCanvas;
+    // Fully opaque parts of mPaintDamage, found while mOpaqueDetection is
+    // set.
+    bool mOpaqueDetection;
+    std::vector<Rect> mOpaqueRects;
+    // Copy rects of a paint delivered without the canvas, with overlaps
+    // split away unless mCoalescePolicy is COALESCE_NONE.
+    DirtyRegion mSourceDamage;
+    // Page damage not yet reported to the FrameBatchDelegate.
+    DirtyRegion mBatchDamage;
+    // Widget paints of a canvas-enabled Window, in creation order. They are
+    // kept until the batch goes out while a FrameBatchDelegate is set, and
+    // for as long as the widget lives while compositing.
+    std::vector<WidgetCanvas*> mWidgetCanvases;
+    // True if Root will call takeFrameUpdates at the end of this update.
+    bool mFrameBatchQueued;
+    // Scratch copy rect list handed out by paintRectArena.
+    std::vector<Rect> mPaintRectArena;
+    PaintStats mPaintStats;
+    LatencyStats mLatencyStats;
 
     // Manages creation and swapping of render views.
     RenderViewHost *mRenderViewHost;
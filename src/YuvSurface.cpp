@@ -0,0 +1,258 @@
+/*  Berkelium Implementation
+ *  YuvSurface.cpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "YuvSurface.hpp"
+#include "Canvas.hpp"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BERKELIUM_YUV_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Berkelium {
+
+namespace {
+
+// BT.601 limited range in 8 bit fixed point, from BGRA byte order.
+inline unsigned char lumaOf(int b, int g, int r) {
+    return (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+inline unsigned char chromaUOf(int b, int g, int r) {
+    return (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+inline unsigned char chromaVOf(int b, int g, int r) {
+    return (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// Converts pixels [x, endX) of one row. Pixels past srcWidth repeat the
+// last one.
+void lumaRow(const unsigned char *src, int srcWidth, unsigned char *dest,
+             int x, int endX) {
+#if defined(BERKELIUM_YUV_SSE2)
+    const int fullEnd = endX < srcWidth ? endX : srcWidth;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i coeffs = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i offset = _mm_set1_epi32(16);
+    for (; x + 4 <= fullEnd; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        // 25b + 129g and 66r of each pixel, then their sum in lanes 0, 2.
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), coeffs);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), coeffs);
+        lo = _mm_add_epi32(lo, _mm_srli_si128(lo, 4));
+        hi = _mm_add_epi32(hi, _mm_srli_si128(hi, 4));
+        __m128i y = _mm_unpacklo_epi64(
+            _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0)),
+            _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0)));
+        y = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(y, round), 8), offset);
+        y = _mm_packs_epi32(y, y);
+        int packed = _mm_cvtsi128_si32(_mm_packus_epi16(y, y));
+        memcpy(dest + x, &packed, 4);
+    }
+#endif
+    for (; x < endX; ++x) {
+        const unsigned char *p = src + (x < srcWidth ? x : srcWidth - 1) * 4;
+        dest[x] = lumaOf(p[0], p[1], p[2]);
+    }
+}
+
+// Converts chroma samples [cx, endCX) from the rows above and below them.
+// U and V are written |step| bytes apart: 1 for separate planes, 2 for
+// interleaved.
+void chromaRow(const unsigned char *row0, const unsigned char *row1,
+               int srcWidth, unsigned char *destU, unsigned char *destV,
+               int step, int cx, int endCX) {
+#if defined(BERKELIUM_YUV_SSE2)
+    const int fullEnd = endCX < srcWidth / 2 ? endCX : srcWidth / 2;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i coeffsU = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+    const __m128i coeffsV = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+    const __m128i round = _mm_set1_epi32(128);
+    for (; cx + 2 <= fullEnd; cx += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(row0 + cx * 8));
+        __m128i b = _mm_loadu_si128((const __m128i*)(row1 + cx * 8));
+        // Averages of each 2x2 block as 16 bit BGRA, both blocks side by side.
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                   _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                   _mm_unpackhi_epi8(b, zero));
+        lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+        __m128i avg = _mm_srli_epi16(
+            _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+        __m128i u = _mm_madd_epi16(avg, coeffsU);
+        __m128i v = _mm_madd_epi16(avg, coeffsV);
+        u = _mm_srai_epi32(
+            _mm_add_epi32(_mm_add_epi32(u, _mm_srli_si128(u, 4)), round), 8);
+        v = _mm_srai_epi32(
+            _mm_add_epi32(_mm_add_epi32(v, _mm_srli_si128(v, 4)), round), 8);
+        destU[cx * step] = (unsigned char)(_mm_cvtsi128_si32(u) + 128);
+        destU[(cx + 1) * step] =
+            (unsigned char)(_mm_cvtsi128_si32(_mm_srli_si128(u, 8)) + 128);
+        destV[cx * step] = (unsigned char)(_mm_cvtsi128_si32(v) + 128);
+        destV[(cx + 1) * step] =
+            (unsigned char)(_mm_cvtsi128_si32(_mm_srli_si128(v, 8)) + 128);
+    }
+#endif
+    for (; cx < endCX; ++cx) {
+        const int x0 = 2 * cx < srcWidth ? 2 * cx : srcWidth - 1;
+        const int x1 = 2 * cx + 1 < srcWidth ? 2 * cx + 1 : srcWidth - 1;
+        int sum[3];
+        for (int c = 0; c < 3; ++c) {
+            sum[c] = (row0[x0 * 4 + c] + row0[x1 * 4 + c] +
+                      row1[x0 * 4 + c] + row1[x1 * 4 + c] + 2) >> 2;
+        }
+        destU[cx * step] = chromaUOf(sum[0], sum[1], sum[2]);
+        destV[cx * step] = chromaVOf(sum[0], sum[1], sum[2]);
+    }
+}
+
+}
+
+YuvSurface::YuvSurface(YuvFormat format)
+    : mFormat(format), mWidth(0), mHeight(0), mColumns(0), mRows(0) {
+}
+
+bool YuvSurface::update(const Canvas &canvas,
+                        size_t numRects, const Rect *rects) {
+    bool reallocated = false;
+    if (canvas.width() != mWidth || canvas.height() != mHeight) {
+        mWidth = canvas.width();
+        mHeight = canvas.height();
+        mColumns = (mWidth + kMacroblockSize - 1) / kMacroblockSize;
+        mRows = (mHeight + kMacroblockSize - 1) / kMacroblockSize;
+        const size_t lumaSize = (size_t)mColumns * mRows *
+            kMacroblockSize * kMacroblockSize;
+        // The planes keep their capacity when the page shrinks.
+        reallocated = lumaSize > mY.capacity();
+        mY.assign(lumaSize, 16);
+        mUV.assign(lumaSize / 2, 128);
+        mDirtyBlocks.assign((size_t)mColumns * mRows, 1);
+        mDirtyRows.assign(mRows, 0);
+    } else {
+        for (size_t i = 0; i < numRects; ++i) {
+            Rect r = rects[i].intersect(canvas.rect());
+            if (r.isEmpty()) {
+                continue;
+            }
+            const int endColumn =
+                (r.right() + kMacroblockSize - 1) / kMacroblockSize;
+            const int endRow =
+                (r.bottom() + kMacroblockSize - 1) / kMacroblockSize;
+            for (int row = r.top() / kMacroblockSize; row < endRow; ++row) {
+                for (int column = r.left() / kMacroblockSize;
+                     column < endColumn; ++column) {
+                    mDirtyBlocks[(size_t)row * mColumns + column] = 1;
+                }
+            }
+        }
+    }
+    if (!canvas.data()) {
+        return reallocated;
+    }
+    for (int row = 0; row < mRows; ++row) {
+        unsigned char *flags = &mDirtyBlocks[(size_t)row * mColumns];
+        for (int column = 0; column < mColumns; ++column) {
+            if (!flags[column]) {
+                continue;
+            }
+            int endColumn = column;
+            while (endColumn < mColumns && flags[endColumn]) {
+                flags[endColumn++] = 0;
+            }
+            convertRun(canvas, row, column, endColumn);
+            mDirtyRows[row] = 1;
+            column = endColumn;
+        }
+    }
+    return reallocated;
+}
+
+void YuvSurface::convertRun(const Canvas &canvas, int row, int firstColumn,
+                            int endColumn) {
+    const size_t yStride = (size_t)mColumns * kMacroblockSize;
+    const int x = firstColumn * kMacroblockSize;
+    const int endX = endColumn * kMacroblockSize;
+    const int top = row * kMacroblockSize;
+    for (int y = top; y < top + kMacroblockSize; y += 2) {
+        const unsigned char *row0 = canvas.data() +
+            (y < mHeight ? y : mHeight - 1) * canvas.stride();
+        const unsigned char *row1 = canvas.data() +
+            (y + 1 < mHeight ? y + 1 : mHeight - 1) * canvas.stride();
+        lumaRow(row0, mWidth, &mY[y * yStride], x, endX);
+        lumaRow(row1, mWidth, &mY[(y + 1) * yStride], x, endX);
+        const size_t chromaRowIndex = y / 2;
+        if (mFormat == YUV_FORMAT_NV12) {
+            unsigned char *uv = &mUV[chromaRowIndex * yStride];
+            chromaRow(row0, row1, mWidth, uv, uv + 1, 2, x / 2, endX / 2);
+        } else {
+            const size_t uvStride = yStride / 2;
+            unsigned char *u = &mUV[chromaRowIndex * uvStride];
+            unsigned char *v = u + mUV.size() / 2;
+            chromaRow(row0, row1, mWidth, u, v, 1, x / 2, endX / 2);
+        }
+    }
+}
+
+void YuvSurface::getFrame(YuvFrame &frame) const {
+    const size_t yStride = (size_t)mColumns * kMacroblockSize;
+    frame.mFormat = mFormat;
+    frame.mWidth = mWidth;
+    frame.mHeight = mHeight;
+    frame.mCodedWidth = mColumns * kMacroblockSize;
+    frame.mCodedHeight = mRows * kMacroblockSize;
+    frame.mY = mY.empty() ? NULL : &mY[0];
+    frame.mYStride = yStride;
+    frame.mU = mUV.empty() ? NULL : &mUV[0];
+    if (mFormat == YUV_FORMAT_NV12) {
+        frame.mV = NULL;
+        frame.mUVStride = yStride;
+    } else {
+        frame.mV = mUV.empty() ? NULL : &mUV[mUV.size() / 2];
+        frame.mUVStride = yStride / 2;
+    }
+}
+
+void YuvSurface::drainDirtyRows(std::vector<int> &rows) {
+    rows.clear();
+    for (int row = 0; row < mRows; ++row) {
+        if (mDirtyRows[row]) {
+            rows.push_back(row);
+            mDirtyRows[row] = 0;
+        }
+    }
+}
+
+}
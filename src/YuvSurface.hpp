@@ -0,0 +1,88 @@
+/*  Berkelium Implementation
+ *  YuvSurface.hpp
+ *
+ *  Copyright (c) 2010, The Sirikata team
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *  * Neither the name of Sirikata nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BERKELIUM_YUVSURFACE_HPP_
+#define _BERKELIUM_YUVSURFACE_HPP_
+
+#include "berkelium/Platform.hpp"
+#include "berkelium/Rect.hpp"
+#include "berkelium/YuvFrame.hpp"
+#include <vector>
+
+namespace Berkelium {
+
+class Canvas;
+
+// A copy of a Canvas in I420 or NV12, for feeding a video encoder. Damage
+// is widened to whole 16x16 macroblocks, each dirty macroblock is converted
+// once per update() however many rects touch it, and the macroblock rows
+// that changed are remembered until drainDirtyRows().
+class YuvSurface {
+public:
+    static const int kMacroblockSize = 16;
+
+    explicit YuvSurface(YuvFormat format);
+
+    YuvFormat format() const {
+        return mFormat;
+    }
+
+    // Matches the size of |canvas| and converts the macroblocks under the
+    // given rects. Returns true if the planes had to be reallocated, in
+    // which case every macroblock was converted.
+    bool update(const Canvas &canvas, size_t numRects, const Rect *rects);
+
+    void getFrame(YuvFrame &frame) const;
+
+    // Replaces |rows| with the indices of macroblock rows changed since the
+    // last call, in increasing order.
+    void drainDirtyRows(std::vector<int> &rows);
+
+private:
+    void convertRun(const Canvas &canvas, int row, int firstColumn,
+                    int endColumn);
+
+    YuvFormat mFormat;
+    int mWidth;
+    int mHeight;
+    int mColumns;
+    int mRows;
+    std::vector<unsigned char> mY;
+    std::vector<unsigned char> mUV;
+    // One flag per macroblock, scratch for a single update().
+    std::vector<unsigned char> mDirtyBlocks;
+    std::vector<unsigned char> mDirtyRows;
+};
+
+}
+
+#endif